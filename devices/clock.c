@@ -0,0 +1,112 @@
+#include "devices/clock.h"
+#include <debug.h>
+#include "devices/pit.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+
+/* High-resolution clock.
+
+   The time-stamp counter (TSC) counts CPU clock cycles, which
+   makes it a cheap clock with a fine resolution, but its
+   frequency has to be measured.  clock_init() does that once, by
+   counting the cycles that pass while PIT channel 2, which is not
+   otherwise used while booting, counts down for
+   CALIBRATE_MS milliseconds.  Channel 0, the timer tick, is left
+   alone, so the measurement neither waits for timer interrupts
+   nor is disturbed by them.
+
+   Converting cycles to nanoseconds would take a 64-bit division,
+   so clock_init() also computes NS_MULT and NS_SHIFT such that a
+   cycle is NS_MULT / 2**NS_SHIFT nanoseconds, as closely as a
+   32-bit NS_MULT allows. */
+
+/* Length of the calibration countdown. */
+#define CALIBRATE_MS 10
+#define CALIBRATE_COUNT (PIT_HZ * CALIBRATE_MS / 1000)
+
+/* PIT channel 2 gate register, shared with the speaker. */
+#define PIT_PORT_GATE 0x61
+#define PIT_GATE_ENABLE 0x01    /* Let channel 2 count. */
+#define PIT_SPEAKER_ENABLE 0x02 /* Connect channel 2 to speaker. */
+#define PIT_OUT2 0x20           /* Channel 2 output. */
+
+/* TSC frequency in Hz, or 0 before clock_init(). */
+static uint64_t tsc_hz;
+
+/* TSC at clock_init(), the zero point of clock_ns(). */
+static uint64_t start_tsc;
+
+/* Cycles to nanoseconds conversion factor. */
+static uint32_t ns_mult;
+static int ns_shift;
+
+/* Measures the TSC frequency.  Should be called once, early;
+   the clock reads 0 until then. */
+void
+clock_init (void)
+{
+  enum intr_level old_level;
+  uint64_t start, end;
+  uint8_t gate;
+
+  old_level = intr_disable ();
+  gate = inb (PIT_PORT_GATE);
+  outb (PIT_PORT_GATE, (gate & ~PIT_SPEAKER_ENABLE) | PIT_GATE_ENABLE);
+  pit_start_countdown (2, CALIBRATE_COUNT);
+  start = rdtsc ();
+  while ((inb (PIT_PORT_GATE) & PIT_OUT2) == 0)
+    continue;
+  end = rdtsc ();
+  outb (PIT_PORT_GATE, gate);
+  intr_set_level (old_level);
+
+  tsc_hz = (end - start) * PIT_HZ / CALIBRATE_COUNT;
+  ASSERT (tsc_hz > 0);
+
+  for (ns_shift = 32; ns_shift > 0; ns_shift--)
+    if (((uint64_t) NSEC_PER_SEC << ns_shift) / tsc_hz <= UINT32_MAX)
+      break;
+  ns_mult = ((uint64_t) NSEC_PER_SEC << ns_shift) / tsc_hz;
+  start_tsc = end;
+}
+
+/* Returns the TSC frequency in Hz, or 0 if it has not been
+   measured yet. */
+uint64_t
+clock_tsc_hz (void)
+{
+  return tsc_hz;
+}
+
+/* Returns the number of nanoseconds since clock_init().  May be
+   called in any context.  The clock does not go backward on any
+   one CPU, and the CPUs' clocks agree as closely as their TSCs
+   do. */
+int64_t
+clock_ns (void)
+{
+  if (tsc_hz == 0)
+    return 0;
+  return clock_tsc_to_ns (rdtsc () - start_tsc);
+}
+
+/* Converts a number of TSC CYCLES into nanoseconds. */
+int64_t
+clock_tsc_to_ns (uint64_t cycles)
+{
+  uint64_t hi = cycles >> 32;
+  uint64_t lo = (uint32_t) cycles;
+
+  return ((hi * ns_mult) << (32 - ns_shift)) + ((lo * ns_mult) >> ns_shift);
+}
+
+/* Converts NS nanoseconds into TSC cycles. */
+uint64_t
+clock_ns_to_tsc (int64_t ns)
+{
+  if (ns <= 0)
+    return 0;
+  return (ns / NSEC_PER_SEC * tsc_hz
+          + ns % NSEC_PER_SEC * tsc_hz / NSEC_PER_SEC);
+}
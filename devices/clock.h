@@ -0,0 +1,15 @@
+#ifndef DEVICES_CLOCK_H
+#define DEVICES_CLOCK_H
+
+#include <stdint.h>
+
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000
+
+void clock_init (void);
+uint64_t clock_tsc_hz (void);
+int64_t clock_ns (void);
+int64_t clock_tsc_to_ns (uint64_t cycles);
+uint64_t clock_ns_to_tsc (int64_t ns);
+
+#endif /* devices/clock.h */
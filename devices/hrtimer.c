@@ -0,0 +1,150 @@
+#include "devices/hrtimer.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+
+/* Pending hrtimers, earliest expiration on top. */
+static struct heap queue;
+
+/* Protects the queue, including the `pending' members of the
+   hrtimers in it, against other CPUs. */
+static struct spinlock queue_lock;
+
+static heap_less_func expires_later;
+
+/* Initializes the hrtimer queue.  Must be called before any
+   hrtimer is started. */
+void
+hrtimer_queue_init (void)
+{
+  heap_init (&queue, expires_later, NULL);
+  spinlock_init (&queue_lock);
+}
+
+/* Initializes T to call FUNC with AUX when it expires.  T is not
+   pending until hrtimer_start() is called. */
+void
+hrtimer_init (struct hrtimer *t, hrtimer_func *func, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  t->func = func;
+  t->aux = aux;
+  t->expires = 0;
+  t->pending = false;
+}
+
+/* Arranges for T to fire when clock_ns() reaches EXPIRES.  If T
+   is already pending, it is rescheduled.  If EXPIRES has already
+   passed, T fires as soon as the timer can interrupt.
+
+   This function may be called from an interrupt handler,
+   including from an hrtimer's own function. */
+void
+hrtimer_start (struct hrtimer *t, int64_t expires)
+{
+  enum intr_level old_level;
+  bool first;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&queue_lock);
+  if (t->pending)
+    heap_remove (&queue, &t->elem);
+  t->expires = expires;
+  t->pending = true;
+  heap_push (&queue, &t->elem);
+  first = heap_top (&queue) == &t->elem;
+  spin_unlock (&queue_lock);
+
+  if (first)
+    timer_reprogram ();
+  intr_set_level (old_level);
+}
+
+/* Cancels T.  Returns true if T was pending, false if it had
+   already fired or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *t)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&queue_lock);
+  was_pending = t->pending;
+  if (was_pending)
+    {
+      heap_remove (&queue, &t->elem);
+      t->pending = false;
+    }
+  spin_unlock (&queue_lock);
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Fires every pending hrtimer that expires at or before NOW.
+   Called by the timer softirq.  As in timeout_run(), functions
+   are called without the queue lock held, at the caller's
+   interrupt level. */
+void
+hrtimer_run (int64_t now)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  spin_lock (&queue_lock);
+  while (!heap_empty (&queue))
+    {
+      struct hrtimer *t = heap_entry (heap_top (&queue),
+                                      struct hrtimer, elem);
+      hrtimer_func *func = t->func;
+      void *aux = t->aux;
+
+      if (t->expires > now)
+        break;
+      heap_pop (&queue);
+      t->pending = false;
+      spin_unlock (&queue_lock);
+      intr_set_level (old_level);
+      func (aux);
+      intr_disable ();
+      spin_lock (&queue_lock);
+    }
+  spin_unlock (&queue_lock);
+  intr_set_level (old_level);
+}
+
+/* Returns the expiration of the earliest pending hrtimer, or
+   INT64_MAX if there is none. */
+int64_t
+hrtimer_next_expiry (void)
+{
+  int64_t expires = INT64_MAX;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spin_lock (&queue_lock);
+  if (!heap_empty (&queue))
+    expires = heap_entry (heap_top (&queue), struct hrtimer, elem)->expires;
+  spin_unlock (&queue_lock);
+  return expires;
+}
+
+/* Orders hrtimers so that the earliest expiration is the
+   heap's maximum. */
+static bool
+expires_later (const struct heap_elem *a_, const struct heap_elem *b_,
+               void *aux UNUSED)
+{
+  const struct hrtimer *a = heap_entry (a_, struct hrtimer, elem);
+  const struct hrtimer *b = heap_entry (b_, struct hrtimer, elem);
+
+  return a->expires > b->expires;
+}
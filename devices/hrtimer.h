@@ -0,0 +1,41 @@
+#ifndef DEVICES_HRTIMER_H
+#define DEVICES_HRTIMER_H
+
+#include <heap.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A one-shot high-resolution timer.
+
+   Like a timeout (see devices/timeout.h), an hrtimer calls FUNC,
+   passing AUX, from the timer softirq, but it expires at a time
+   given in clock_ns() nanoseconds rather than in timer ticks.
+   The timer interrupt is programmed to arrive when the earliest
+   hrtimer is due, even between ticks.  FUNC runs in interrupt
+   context, so it may not sleep.
+
+   Pending hrtimers are kept in a heap ordered by expiration, so
+   there should not be very many of them: timeouts are cheaper
+   for anything that can wait for a tick. */
+
+typedef void hrtimer_func (void *aux);
+
+struct hrtimer
+  {
+    struct heap_elem elem;      /* Element in the hrtimer heap. */
+    int64_t expires;            /* clock_ns() at which to fire. */
+    hrtimer_func *func;         /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Started and not yet fired or cancelled? */
+  };
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+
+/* For use by devices/timer.c. */
+void hrtimer_queue_init (void);
+void hrtimer_run (int64_t now);
+int64_t hrtimer_next_expiry (void);
+
+#endif /* devices/hrtimer.h */
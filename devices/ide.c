@@ -8,6 +8,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 
 /* The code in this file is an interface to an ATA (IDE)
@@ -70,7 +71,10 @@ struct channel
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
-    struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct semaphore completion_wait;   /* Up'd by ide_softirq(). */
+    unsigned completions;       /* Interrupts not yet passed on to
+                                   completion_wait, with interrupts
+                                   off to access. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -96,6 +100,7 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static softirq_func ide_softirq;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -103,6 +108,8 @@ ide_init (void)
 {
   size_t chan_no;
 
+  softirq_register (SOFTIRQ_BLOCK, ide_softirq);
+
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
       struct channel *c = &channels[chan_no];
@@ -123,9 +130,10 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->completions = 0;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -514,7 +522,8 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
-            sema_up (&c->completion_wait);      /* Wake up waiter. */
+            c->completions++;                   /* Wake up waiter... */
+            softirq_raise (SOFTIRQ_BLOCK);      /* ...in ide_softirq(). */
           }
         else
           printf ("%s: unexpected interrupt\n", c->name);
@@ -524,4 +533,21 @@ interrupt_handler (struct intr_frame *f)
   NOT_REACHED ();
 }
 
+/* Wakes up the threads waiting for the completions that
+   interrupt_handler() acknowledged. */
+static void
+ide_softirq (void) 
+{
+  struct channel *c;
 
+  for (c = channels; c < channels + CHANNEL_CNT; c++)
+    {
+      enum intr_level old_level = intr_disable ();
+      unsigned completions = c->completions;
+      c->completions = 0;
+      intr_set_level (old_level);
+
+      while (completions-- > 0)
+        sema_up (&c->completion_wait);
+    }
+}
@@ -19,9 +19,11 @@ void
 input_putc (uint8_t key) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT (!intq_full (&buffer));
 
+  intq_lock (&buffer);
+  ASSERT (!intq_full (&buffer));
   intq_putc (&buffer, key);
+  intq_unlock (&buffer);
   serial_notify ();
 }
 
@@ -34,7 +36,9 @@ input_getc (void)
   uint8_t key;
 
   old_level = intr_disable ();
+  intq_lock (&buffer);
   key = intq_getc (&buffer);
+  intq_unlock (&buffer);
   serial_notify ();
   intr_set_level (old_level);
   
@@ -43,10 +47,17 @@ input_getc (void)
 
 /* Returns true if the input buffer is full,
    false otherwise.
-   Interrupts must be off. */
+   Interrupts must be off.  Keys are only added by interrupt
+   handlers on the bootstrap processor, so a false result stays
+   valid until its caller adds a key. */
 bool
 input_full (void) 
 {
+  bool full;
+
   ASSERT (intr_get_level () == INTR_OFF);
-  return intq_full (&buffer);
+  intq_lock (&buffer);
+  full = intq_full (&buffer);
+  intq_unlock (&buffer);
+  return full;
 }
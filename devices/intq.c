@@ -10,16 +10,32 @@ static void signal (struct intq *q, struct thread **waiter);
 void
 intq_init (struct intq *q) 
 {
-  lock_init (&q->lock);
+  spinlock_init (&q->spin);
+  lock_init (&q->lock, "intq");
   q->not_full = q->not_empty = NULL;
   q->head = q->tail = 0;
 }
 
+/* Acquires Q's spin lock.  Interrupts must be off. */
+void
+intq_lock (struct intq *q)
+{
+  spin_lock (&q->spin);
+}
+
+/* Releases Q's spin lock. */
+void
+intq_unlock (struct intq *q)
+{
+  spin_unlock (&q->spin);
+}
+
 /* Returns true if Q is empty, false otherwise. */
 bool
 intq_empty (const struct intq *q) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (q->spin.locked);
   return q->head == q->tail;
 }
 
@@ -28,6 +44,7 @@ bool
 intq_full (const struct intq *q) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (q->spin.locked);
   return next (q->head) == q->tail;
 }
 
@@ -43,9 +60,14 @@ intq_getc (struct intq *q)
   while (intq_empty (q)) 
     {
       ASSERT (!intr_context ());
+      spin_unlock (&q->spin);
       lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
+      spin_lock (&q->spin);
+      if (intq_empty (q))
+        wait (q, &q->not_empty);
+      spin_unlock (&q->spin);
       lock_release (&q->lock);
+      spin_lock (&q->spin);
     }
   
   byte = q->buf[q->tail];
@@ -64,9 +86,14 @@ intq_putc (struct intq *q, uint8_t byte)
   while (intq_full (q))
     {
       ASSERT (!intr_context ());
+      spin_unlock (&q->spin);
       lock_acquire (&q->lock);
-      wait (q, &q->not_full);
+      spin_lock (&q->spin);
+      if (intq_full (q))
+        wait (q, &q->not_full);
+      spin_unlock (&q->spin);
       lock_release (&q->lock);
+      spin_lock (&q->spin);
     }
 
   q->buf[q->head] = byte;
@@ -82,9 +109,10 @@ next (int pos)
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until the given condition is true, releasing
+   Q's spin lock while it waits. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+wait (struct intq *q, struct thread **waiter) 
 {
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
@@ -92,7 +120,8 @@ wait (struct intq *q UNUSED, struct thread **waiter)
           || (waiter == &q->not_full && intq_full (q)));
 
   *waiter = thread_current ();
-  thread_block ();
+  thread_block_unlock (&q->spin);
+  spin_lock (&q->spin);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
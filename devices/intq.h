@@ -2,6 +2,7 @@
 #define DEVICES_INTQ_H
 
 #include "threads/interrupt.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 
 /* An "interrupt queue", a circular buffer shared between
@@ -9,7 +10,11 @@
 
    Interrupt queue functions can be called from kernel threads or
    from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
+   intq_lock(), and intq_unlock(), interrupts must be off and the
+   queue's spin lock must be held in either case, because a
+   thread on another CPU may use the queue at the same time.
+   intq_getc() and intq_putc() release the spin lock while they
+   wait.
 
    The interrupt queue has the structure of a "monitor".  Locks
    and condition variables from threads/synch.h cannot be used in
@@ -23,6 +28,8 @@
 /* A circular queue of bytes. */
 struct intq
   {
+    struct spinlock spin;       /* Protects the members below. */
+
     /* Waiting threads. */
     struct lock lock;           /* Only one thread may wait at once. */
     struct thread *not_full;    /* Thread waiting for not-full condition. */
@@ -35,6 +42,8 @@ struct intq
   };
 
 void intq_init (struct intq *);
+void intq_lock (struct intq *);
+void intq_unlock (struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
@@ -0,0 +1,320 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Local APIC.
+
+   Each CPU has its own local APIC, which delivers interrupts to
+   it and lets it send interprocessor interrupts (IPIs) to the
+   other CPUs.  All of them are accessed through the same
+   physical addresses, each CPU seeing its own.  Refer to
+   [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)" for details.
+
+   Devices still interrupt through the 8259A PICs, which the
+   BIOS leaves wired to the bootstrap processor's LINT0 input
+   ("virtual wire" mode), so the local APICs carry only IPIs and
+   their own timers' interrupts.
+
+   Each local APIC timer counts down at the same rate, a fraction
+   of the bus clock that lapic_timer_calibrate() measures, and
+   interrupts its own CPU, once or periodically. */
+
+/* Register offsets, in bytes. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task priority. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_ESR       0x280   /* Error status. */
+#define LAPIC_ICRLO     0x300   /* Interrupt command, bits 0-31. */
+#define LAPIC_ICRHI     0x310   /* Interrupt command, bits 32-63. */
+#define LAPIC_TIMER     0x320   /* Local vector table: timer. */
+#define LAPIC_LINT0     0x350   /* Local vector table: LINT0. */
+#define LAPIC_LINT1     0x360   /* Local vector table: LINT1. */
+#define LAPIC_ERROR     0x370   /* Local vector table: error. */
+#define LAPIC_TIMER_ICR 0x380   /* Timer initial count. */
+#define LAPIC_TIMER_CCR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DCR 0x3e0   /* Timer divide configuration. */
+
+/* Spurious interrupt vector register bits. */
+#define SVR_ENABLE      0x00000100      /* APIC software enable. */
+
+/* Local vector table entry bits. */
+#define LVT_NMI         0x00000400      /* Deliver as NMI. */
+#define LVT_EXTINT      0x00000700      /* Deliver from the PIC. */
+#define LVT_MASKED      0x00010000      /* Interrupt masked. */
+#define LVT_PERIODIC    0x00020000      /* Timer: reload at zero. */
+
+/* Timer divide configuration: count once every 16 bus cycles. */
+#define DCR_DIV_16      0x00000003
+
+/* Length of the timer calibration, in milliseconds. */
+#define TIMER_CALIBRATE_MS 10
+
+/* Interrupt command register bits. */
+#define ICR_FIXED       0x00000000      /* Deliver to vector. */
+#define ICR_INIT        0x00000500      /* INIT. */
+#define ICR_STARTUP     0x00000600      /* Start-up IPI (SIPI). */
+#define ICR_PENDING     0x00001000      /* Delivery status. */
+#define ICR_ASSERT      0x00004000      /* Level assert. */
+#define ICR_LEVEL       0x00008000      /* Level triggered. */
+#define ICR_ALL_BUT_SELF 0x000c0000     /* Destination shorthand. */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE   0x1b
+#define APIC_BASE_ENABLE 0x800          /* APIC global enable. */
+
+/* CPUID leaf 1 EDX bit: local APIC present. */
+#define CPUID_APIC      (1 << 9)
+
+/* The registers are mapped at this kernel virtual address, which
+   lies above the kernel's mapping of RAM (at most 64 MB, see
+   start.S), so nothing else uses it.  It is the registers'
+   usual physical address, but need not be. */
+#define LAPIC_VADDR     0xfee00000
+
+/* Mapped registers, or a null pointer if the local APIC has not
+   been enabled. */
+static volatile uint32_t *lapic;
+
+static void map_registers (uint32_t paddr);
+static void setup (bool bsp);
+static void wait_icr (void);
+
+/* Reads local APIC register REG. */
+static inline uint32_t
+lapic_read (int reg)
+{
+  return lapic[reg / 4];
+}
+
+/* Writes VALUE to local APIC register REG. */
+static inline void
+lapic_write (int reg, uint32_t value)
+{
+  lapic[reg / 4] = value;
+  (void) lapic[LAPIC_ID / 4];   /* Wait for the write to finish. */
+}
+
+/* Executes CPUID leaf LEAF and returns EDX. */
+static inline uint32_t
+cpuid_edx (uint32_t leaf)
+{
+  uint32_t eax = leaf, ebx, ecx = 0, edx;
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Reads model-specific register MSR. */
+static inline uint64_t
+rdmsr (uint32_t msr)
+{
+  uint64_t value;
+  asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+  return value;
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Enables the bootstrap processor's local APIC.  Returns false,
+   leaving everything as it was, if the CPU does not have one.
+   Must be called before any process is created, because the
+   register mapping is added to the kernel page directory, which
+   process page directories copy. */
+bool
+lapic_init (void)
+{
+  uint64_t base;
+
+  ASSERT (lapic == NULL);
+
+  if (!(cpuid_edx (1) & CPUID_APIC))
+    return false;
+
+  base = rdmsr (MSR_APIC_BASE);
+  if (!(base & APIC_BASE_ENABLE))
+    wrmsr (MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+  map_registers (base & PTE_ADDR);
+  setup (true);
+  return true;
+}
+
+/* Enables the local APIC of the application processor that is
+   running. */
+void
+lapic_init_ap (void)
+{
+  ASSERT (lapic != NULL);
+  setup (false);
+}
+
+/* Returns true if lapic_init() has succeeded. */
+bool
+lapic_enabled (void)
+{
+  return lapic != NULL;
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void)
+{
+  ASSERT (lapic != NULL);
+  return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Acknowledges the interrupt being processed by the running
+   CPU. */
+void
+lapic_eoi (void)
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends an interrupt on vector VEC to the CPU whose local APIC
+   ID is APIC_ID.  Interrupts must be off, so that the running
+   thread cannot move to another CPU halfway through. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec)
+{
+  ASSERT (lapic != NULL);
+
+  wait_icr ();
+  lapic_write (LAPIC_ICRHI, (uint32_t) apic_id << 24);
+  lapic_write (LAPIC_ICRLO, ICR_FIXED | vec);
+}
+
+/* Starts all the application processors, using the INIT-SIPI-SIPI
+   sequence from [MP] appendix B.4, so that they begin executing
+   in real mode at physical address START_PADDR, which must be
+   page-aligned and below 1 MB. */
+void
+lapic_start_aps (uint32_t start_paddr)
+{
+  ASSERT (lapic != NULL);
+  ASSERT (start_paddr % PGSIZE == 0 && start_paddr < 0x100000);
+
+  lapic_write (LAPIC_ICRLO, ICR_ALL_BUT_SELF | ICR_INIT | ICR_LEVEL
+               | ICR_ASSERT);
+  wait_icr ();
+  timer_mdelay (10);
+
+  lapic_write (LAPIC_ICRLO, ICR_ALL_BUT_SELF | ICR_STARTUP
+               | (start_paddr >> 12));
+  wait_icr ();
+  timer_udelay (200);
+
+  lapic_write (LAPIC_ICRLO, ICR_ALL_BUT_SELF | ICR_STARTUP
+               | (start_paddr >> 12));
+  wait_icr ();
+}
+
+/* Measures and returns the frequency of the local APIC timers,
+   in counts per second.  The timer clock is timed against the
+   time-stamp counter, so clock_init() must already have been
+   called. */
+uint32_t
+lapic_timer_calibrate (void)
+{
+  enum intr_level old_level;
+  uint32_t count;
+
+  ASSERT (lapic != NULL);
+
+  old_level = intr_disable ();
+  lapic_write (LAPIC_TIMER, LVT_MASKED);
+  lapic_write (LAPIC_TIMER_ICR, UINT32_MAX);
+  timer_mdelay (TIMER_CALIBRATE_MS);
+  count = UINT32_MAX - lapic_read (LAPIC_TIMER_CCR);
+  lapic_write (LAPIC_TIMER_ICR, 0);
+  intr_set_level (old_level);
+
+  return count * (1000 / TIMER_CALIBRATE_MS);
+}
+
+/* Makes the running CPU's timer interrupt it every COUNT
+   counts. */
+void
+lapic_timer_periodic (uint32_t count)
+{
+  ASSERT (count > 0);
+  lapic_write (LAPIC_TIMER, LVT_PERIODIC | LAPIC_VEC_TIMER);
+  lapic_write (LAPIC_TIMER_ICR, count);
+}
+
+/* Makes the running CPU's timer interrupt it once, COUNT counts
+   from now. */
+void
+lapic_timer_oneshot (uint32_t count)
+{
+  ASSERT (count > 0);
+  lapic_write (LAPIC_TIMER, LAPIC_VEC_TIMER);
+  lapic_write (LAPIC_TIMER_ICR, count);
+}
+
+/* Returns the counts left until the running CPU's timer next
+   interrupts, or 0 if a one-shot countdown has ended. */
+uint32_t
+lapic_timer_read (void)
+{
+  return lapic_read (LAPIC_TIMER_CCR);
+}
+
+/* Maps the local APIC registers at physical address PADDR into
+   the kernel page directory, uncached. */
+static void
+map_registers (uint32_t paddr)
+{
+  void *vaddr = (void *) LAPIC_VADDR;
+  uint32_t *pde = init_page_dir + pd_no (vaddr);
+  uint32_t *pt;
+
+  if (*pde == 0)
+    *pde = pde_create (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt (*pde);
+  pt[pt_no (vaddr)] = paddr | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+  lapic = vaddr;
+}
+
+/* Programs the running CPU's local APIC.  BSP is true on the
+   bootstrap processor, which keeps receiving the PICs'
+   interrupts through LINT0. */
+static void
+setup (bool bsp)
+{
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_VEC_SPURIOUS);
+  lapic_write (LAPIC_TIMER, LVT_MASKED);
+  lapic_write (LAPIC_TIMER_DCR, DCR_DIV_16);
+  lapic_write (LAPIC_LINT0, bsp ? LVT_EXTINT : LVT_MASKED);
+  lapic_write (LAPIC_LINT1, bsp ? LVT_NMI : LVT_MASKED);
+  lapic_write (LAPIC_ERROR, LAPIC_VEC_ERROR);
+
+  /* Clear the error status, which takes back-to-back writes. */
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_ESR, 0);
+
+  /* Acknowledge anything left over and accept all
+     interrupts. */
+  lapic_write (LAPIC_EOI, 0);
+  lapic_write (LAPIC_TPR, 0);
+}
+
+/* Waits for the previous interprocessor interrupt to be
+   delivered. */
+static void
+wait_icr (void)
+{
+  while (lapic_read (LAPIC_ICRLO) & ICR_PENDING)
+    asm volatile ("pause");
+}
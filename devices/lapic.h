@@ -0,0 +1,31 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors delivered by the local APIC.  Vectors from
+   LAPIC_VEC_MIN up are external interrupts that are acknowledged
+   on the local APIC instead of the PICs.  The spurious vector
+   must not be acknowledged at all. */
+#define LAPIC_VEC_MIN 0xf0
+#define LAPIC_VEC_RESCHED 0xf0  /* Reschedule IPI. */
+#define LAPIC_VEC_TIMER 0xf1    /* Local APIC timer. */
+#define LAPIC_VEC_ERROR 0xfe    /* APIC error. */
+#define LAPIC_VEC_SPURIOUS 0xff /* Spurious interrupt. */
+
+bool lapic_init (void);
+void lapic_init_ap (void);
+bool lapic_enabled (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+void lapic_start_aps (uint32_t start_paddr);
+
+/* Timer, for use by devices/timer.c. */
+uint32_t lapic_timer_calibrate (void);
+void lapic_timer_periodic (uint32_t count);
+void lapic_timer_oneshot (uint32_t count);
+uint32_t lapic_timer_read (void);
+
+#endif /* devices/lapic.h */
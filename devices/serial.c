@@ -51,7 +51,8 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
+/* Data to be transmitted.  Once in QUEUE mode, its spin lock
+   also serializes access to the UART among CPUs. */
 static struct intq txq;
 
 static void set_serial (int bps);
@@ -90,7 +91,9 @@ serial_init_queue (void)
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
+  intq_lock (&txq);
   write_ier ();
+  intq_unlock (&txq);
   intr_set_level (old_level);
 }
 
@@ -112,6 +115,7 @@ serial_putc (uint8_t byte)
     {
       /* Otherwise, queue a byte and update the interrupt enable
          register. */
+      intq_lock (&txq);
       if (old_level == INTR_OFF && intq_full (&txq)) 
         {
           /* Interrupts are off and the transmit queue is full.
@@ -124,6 +128,7 @@ serial_putc (uint8_t byte)
 
       intq_putc (&txq, byte); 
       write_ier ();
+      intq_unlock (&txq);
     }
   
   intr_set_level (old_level);
@@ -135,8 +140,10 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
+  intq_lock (&txq);
   while (!intq_empty (&txq))
     putc_poll (intq_getc (&txq));
+  intq_unlock (&txq);
   intr_set_level (old_level);
 }
 
@@ -149,7 +156,11 @@ serial_notify (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
   if (mode == QUEUE)
-    write_ier ();
+    {
+      intq_lock (&txq);
+      write_ier ();
+      intq_unlock (&txq);
+    }
 }
 
 /* Configures the serial port for BPS bits per second. */
@@ -172,7 +183,8 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
-/* Update interrupt enable register. */
+/* Update interrupt enable register.  Interrupts must be off and
+   txq's spin lock must be held. */
 static void
 write_ier (void) 
 {
@@ -220,9 +232,11 @@ serial_interrupt (struct intr_frame *f UNUSED)
 
   /* As long as we have a byte to transmit, and the hardware is
      ready to accept a byte for transmission, transmit a byte. */
+  intq_lock (&txq);
   while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
     outb (THR_REG, intq_getc (&txq));
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
+  intq_unlock (&txq);
 }
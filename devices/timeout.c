@@ -0,0 +1,256 @@
+#include "devices/timeout.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+
+/* Hierarchical timer wheel.
+
+   Level 0 ("tv1") has one slot per tick for the next TVR_SIZE
+   ticks.  Each of the TVN_CNT higher levels has TVN_SIZE slots,
+   each slot covering TVN_SIZE times as many ticks as a slot one
+   level down.  A timeout is filed in the lowest level whose range
+   covers its expiration.  Every time the level-0 index wraps
+   around, the current slot of level 1 is "cascaded", that is, its
+   timeouts are refiled into level 0, and so on up the hierarchy.
+
+   Thus adding or cancelling a timeout is a list insertion or
+   removal, and a timer tick only looks at one level-0 slot, all
+   of whose timeouts are due, plus an occasional cascade that each
+   timeout goes through at most TVN_CNT times.  Timeouts further
+   out than the wheel's range are parked in the top level and
+   refiled when they cascade. */
+
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_CNT 4
+
+/* Number of ticks covered by the whole wheel. */
+#define WHEEL_RANGE ((int64_t) 1 << (TVR_BITS + TVN_CNT * TVN_BITS))
+
+static struct list tv1[TVR_SIZE];
+static struct list tvn[TVN_CNT][TVN_SIZE];
+
+/* Next tick to be processed by timeout_run(). */
+static int64_t wheel_tick;
+
+/* Protects the wheel, including the `pending' members of the
+   timeouts in it, against other CPUs. */
+static struct spinlock wheel_lock;
+
+static void wheel_insert (struct timeout *);
+static int cascade (int level);
+
+/* Initializes the timer wheel.  Must be called before any
+   timeout is added. */
+void
+timeout_wheel_init (void)
+{
+  int i, level;
+
+  for (i = 0; i < TVR_SIZE; i++)
+    list_init (&tv1[i]);
+  for (level = 0; level < TVN_CNT; level++)
+    for (i = 0; i < TVN_SIZE; i++)
+      list_init (&tvn[level][i]);
+  wheel_tick = 0;
+  spinlock_init (&wheel_lock);
+}
+
+/* Initializes timeout T to call FUNC with AUX when it expires.
+   T is not pending until timeout_add() is called. */
+void
+timeout_init (struct timeout *t, timeout_func *func, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  t->func = func;
+  t->aux = aux;
+  t->expires = 0;
+  t->pending = false;
+}
+
+/* Arranges for T to fire at timer tick EXPIRES.  If T is already
+   pending, it is rescheduled.  If EXPIRES has already passed, T
+   fires on the next timer tick.
+
+   This function may be called from an interrupt handler,
+   including from a timeout's own function.  Called on a CPU other
+   than the BSP, it wakes the BSP if it sits in a tickless
+   countdown that would end after EXPIRES. */
+void
+timeout_add (struct timeout *t, int64_t expires)
+{
+  enum intr_level old_level;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&wheel_lock);
+  if (t->pending)
+    list_remove (&t->elem);
+  t->expires = expires;
+  t->pending = true;
+  wheel_insert (t);
+  spin_unlock (&wheel_lock);
+  timer_timeout_added (expires);
+  intr_set_level (old_level);
+}
+
+/* Cancels T.  Returns true if T was pending, false if it had
+   already fired or was never added. */
+bool
+timeout_cancel (struct timeout *t)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&wheel_lock);
+  was_pending = t->pending;
+  if (was_pending)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+    }
+  spin_unlock (&wheel_lock);
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Returns true if T has been added and has neither fired nor
+   been cancelled. */
+bool
+timeout_pending (const struct timeout *t)
+{
+  return t->pending;
+}
+
+/* Fires every pending timeout that expires at or before tick
+   NOW.  Called by the timer softirq.
+
+   Timeout functions are called without the wheel lock held, so
+   that they may add timeouts, and at the caller's interrupt
+   level, so that interrupts are off only while the wheel is
+   locked.  Once a timeout is taken off the wheel, it is no longer
+   pending and cancelling it has no effect. */
+void
+timeout_run (int64_t now)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  spin_lock (&wheel_lock);
+  while (wheel_tick <= now)
+    {
+      int index = wheel_tick & TVR_MASK;
+      struct list *slot = &tv1[index];
+      int level;
+
+      /* When level 0 wraps around, refill it from level 1, and
+         level 1 from level 2 whenever level 1 wraps, etc. */
+      if (index == 0)
+        for (level = 0; level < TVN_CNT; level++)
+          if (cascade (level) != 0)
+            break;
+      wheel_tick++;
+
+      while (!list_empty (slot))
+        {
+          struct timeout *t = list_entry (list_pop_front (slot),
+                                          struct timeout, elem);
+          timeout_func *func = t->func;
+          void *aux = t->aux;
+
+          t->pending = false;
+          spin_unlock (&wheel_lock);
+          intr_set_level (old_level);
+          func (aux);
+          intr_disable ();
+          spin_lock (&wheel_lock);
+        }
+    }
+  spin_unlock (&wheel_lock);
+  intr_set_level (old_level);
+}
+
+/* Returns the earliest tick before LIMIT at which timeout_run()
+   may have work to do, or LIMIT if there is none.  Used to decide
+   how long the CPU may sleep without a timer tick.
+
+   Only level 0 is scanned, so the tick at which level 0 next
+   wraps around is also reported, since higher levels cascade
+   then. */
+int64_t
+timeout_next_expiry (int64_t limit)
+{
+  int64_t tick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spin_lock (&wheel_lock);
+  for (tick = wheel_tick; tick < limit; tick++)
+    if ((tick & TVR_MASK) == 0 || !list_empty (&tv1[tick & TVR_MASK]))
+      break;
+  spin_unlock (&wheel_lock);
+  return tick;
+}
+
+/* Files T in the wheel slot that covers its expiration. */
+static void
+wheel_insert (struct timeout *t)
+{
+  int64_t expires = t->expires;
+  int64_t delta = expires - wheel_tick;
+  struct list *slot;
+
+  if (delta < 0)
+    slot = &tv1[wheel_tick & TVR_MASK];
+  else if (delta < TVR_SIZE)
+    slot = &tv1[expires & TVR_MASK];
+  else
+    {
+      int level;
+
+      if (delta >= WHEEL_RANGE)
+        {
+          delta = WHEEL_RANGE - 1;
+          expires = wheel_tick + delta;
+        }
+      for (level = 0; level < TVN_CNT - 1; level++)
+        if (delta < (int64_t) 1 << (TVR_BITS + (level + 1) * TVN_BITS))
+          break;
+      slot = &tvn[level][(expires >> (TVR_BITS + level * TVN_BITS))
+                         & TVN_MASK];
+    }
+  list_push_back (slot, &t->elem);
+}
+
+/* Refiles the timeouts in the current slot of LEVEL into lower
+   levels and returns the slot's index. */
+static int
+cascade (int level)
+{
+  int index = (wheel_tick >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+  struct list *slot = &tvn[level][index];
+  struct list refile;
+
+  /* Empty the slot first, because a timeout that is still out of
+     range may be filed right back into it. */
+  list_init (&refile);
+  while (!list_empty (slot))
+    list_push_back (&refile, list_pop_front (slot));
+  while (!list_empty (&refile))
+    wheel_insert (list_entry (list_pop_front (&refile),
+                              struct timeout, elem));
+
+  return index;
+}
@@ -0,0 +1,40 @@
+#ifndef DEVICES_TIMEOUT_H
+#define DEVICES_TIMEOUT_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A one-shot kernel timer.
+
+   A timeout calls FUNC, passing AUX, from the timer softirq
+   once timer_ticks() reaches its expiration tick.  FUNC runs in
+   interrupt context, so it may not sleep; it will typically
+   unblock a thread or up a semaphore.  Interrupts may be on.
+
+   Pending timeouts are kept in a hierarchical timer wheel, so
+   adding and cancelling a timeout take constant time and each
+   timer tick only touches the timeouts that are due. */
+
+typedef void timeout_func (void *aux);
+
+struct timeout
+  {
+    struct list_elem elem;      /* Element in a timer wheel slot. */
+    int64_t expires;            /* Tick at which to fire. */
+    timeout_func *func;         /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Added and not yet fired or cancelled? */
+  };
+
+void timeout_init (struct timeout *, timeout_func *, void *aux);
+void timeout_add (struct timeout *, int64_t expires);
+bool timeout_cancel (struct timeout *);
+bool timeout_pending (const struct timeout *);
+
+/* For use by devices/timer.c. */
+void timeout_wheel_init (void);
+void timeout_run (int64_t now);
+int64_t timeout_next_expiry (int64_t limit);
+
+#endif /* devices/timeout.h */
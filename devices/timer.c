@@ -3,67 +3,185 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/clock.h"
+#include "devices/hrtimer.h"
+#include "devices/lapic.h"
 #include "devices/pit.h"
+#include "devices/timeout.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
+#include "threads/softirq.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
-/* See [8254] for hardware details of the 8254 timer chip. */
-
-#if TIMER_FREQ < 19
-#error 8254 timer requires TIMER_FREQ >= 19
-#endif
-#if TIMER_FREQ > 1000
-#error TIMER_FREQ <= 1000 recommended
-#endif
-
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
-
-static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+/* Number of timer interrupts per second.
+   Controlled by kernel command-line option "-hz=N". */
+int timer_freq = TIMER_FREQ_DEFAULT;
+
+/* If false (default), the timer interrupts timer_freq times per
+   second, even when the CPU is idle.
+   If true, the idle thread stops the periodic tick and sleeps
+   until the next timeout is due.
+   Controlled by kernel command-line option "-nohz". */
+bool timer_nohz;
+
+/* If false (default), the local APIC timer, if there is one,
+   interrupts each CPU separately.
+   If true, the PIT interrupts the BSP only, as it does until
+   timer_calibrate() is called.
+   Controlled by kernel command-line option "-pit". */
+bool timer_pit;
+
+/* A source of timer interrupts.  Counts are in cycles of the
+   source's clock.  READ returns the cycles left in the current
+   period or countdown, 0 once a countdown has ended. */
+struct tick_source
+  {
+    const char *name;           /* Name, for the boot messages. */
+    uint64_t hz;                /* Cycles per second. */
+    uint32_t max_count;         /* Longest possible countdown. */
+    void (*start_periodic) (uint32_t count);
+    void (*start_oneshot) (uint32_t count);
+    uint32_t (*read) (void);
+  };
+
+static void pit_periodic (uint32_t count);
+static void pit_oneshot (uint32_t count);
+static uint32_t pit_read (void);
+
+/* See [8254] for hardware details of the 8254 timer chip.  Only
+   the BSP receives its interrupts. */
+static struct tick_source pit_source =
+  {"8254 PIT", PIT_HZ, UINT16_MAX, pit_periodic, pit_oneshot, pit_read};
+
+/* Each CPU's local APIC timer interrupts only that CPU.  Its
+   frequency is measured by timer_calibrate(). */
+static struct tick_source lapic_source =
+  {"local APIC", 0, UINT32_MAX,
+   lapic_timer_periodic, lapic_timer_oneshot, lapic_timer_read};
+
+/* Current source of timer interrupts and its cycles per tick. */
+static struct tick_source *source = &pit_source;
+static uint32_t tick_count;
+
+/* Tickless idle state.  While ONESHOT_TICKS is nonzero, the
+   source is counting down ONESHOT_COUNT cycles in one-shot mode
+   instead of interrupting periodically.  The countdown crosses
+   the next tick boundary after ONESHOT_FIRST cycles, and another
+   one every TICK_COUNT cycles after that, ONESHOT_TICKS
+   boundaries in all. */
+static int oneshot_ticks;
+static uint32_t oneshot_first;
+static uint32_t oneshot_count;
+
+/* Other CPUs' view of the BSP's tickless idle.  During a
+   countdown over several ticks, TICKS stands still, so other
+   CPUs count the tick boundaries that have passed since
+   IDLE_FIRST_NS, the clock_ns() time of the first one.  The BSP
+   changes TICKS together with ONESHOT_TICKS, and starts
+   countdowns, with IDLE_LOCK held. */
+static struct spinlock idle_lock;
+static int64_t idle_first_ns;
+
+/* While nonzero, the source is counting down ONESHOT_COUNT
+   cycles in one-shot mode to the expiration of an hrtimer, and
+   the next tick boundary is HR_REST cycles after the countdown
+   ends. */
+static uint32_t hr_rest;
+
+/* MLFQS priorities are recomputed every this many ticks, that
+   is, every 40 ms. */
+static int mlfqs_priority_ticks;
+
+/* Set once a second by account_tick() for timer_softirq() to
+   recompute the MLFQS load average and every thread's
+   recent_cpu and priority. */
+static bool mlfqs_recalc_due;
+
+/* Sleeps shorter than this busy-wait, because blocking and being
+   woken up by an hrtimer would take about as long. */
+#define HR_SLEEP_MIN_NS 20000
+
+/* Serializes timer_sleep() against wake_sleeper(). */
+static struct spinlock sleep_lock;
+
+static intr_handler_func timer_interrupt, pit_interrupt;
+static softirq_func timer_softirq;
+static timeout_func wake_sleeper;
+static void account_tick (bool idle, bool user);
+static bool from_user (const struct intr_frame *);
+static void start_oneshot (int tick_cnt, uint32_t first, uint32_t count);
+static void arm_hrtimer (void);
+static uint32_t ns_to_count (int64_t ns);
+static int idle_ticks_passed (void);
+static void hr_sleep (int64_t ns);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
-/* Sets up the timer to interrupt TIMER_FREQ times per second,
+/* Sets up the PIT to interrupt timer_freq times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void)
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
-  intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+  ASSERT (timer_freq >= TIMER_FREQ_MIN && timer_freq <= TIMER_FREQ_MAX);
+
+  mlfqs_priority_ticks = DIV_ROUND_UP (40 * timer_freq, 1000);
+  tick_count = (source->hz + timer_freq / 2) / timer_freq;
+  source->start_periodic (tick_count);
+  timeout_wheel_init ();
+  hrtimer_queue_init ();
+  softirq_register (SOFTIRQ_TIMER, timer_softirq);
+  intr_register_ext (0x20, pit_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the high-resolution clock, used to implement
+   sub-tick sleeps and brief delays.  Until then, those sleeps
+   never end and those delays do not wait at all.
+
+   Then, unless "-pit" was given, moves the timer tick from
+   the PIT to the local APIC timer, if there is a local APIC.
+   Must be called before any process is created (see
+   lapic_init()). */
 void
 timer_calibrate (void)
 {
-  unsigned high_bit, test_bit;
+  enum intr_level old_level;
 
-  ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
+  clock_init ();
+  printf ("%'"PRIu64" TSC cycles/s.\n", clock_tsc_hz ());
 
-  /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-  loops_per_tick = 1u << 10;
-  while (!too_many_loops (loops_per_tick << 1))
+  if (!timer_pit && lapic_init ())
     {
-      loops_per_tick <<= 1;
-      ASSERT (loops_per_tick != 0);
+      lapic_source.hz = lapic_timer_calibrate ();
+      intr_register_ext (LAPIC_VEC_TIMER, timer_interrupt, "LAPIC Timer");
+
+      old_level = intr_disable ();
+      pit_stop (0);
+      source = &lapic_source;
+      tick_count = (source->hz + timer_freq / 2) / timer_freq;
+      oneshot_ticks = 0;
+      hr_rest = 0;
+      source->start_periodic (tick_count);
+      intr_set_level (old_level);
     }
+  printf ("Timer ticks %d times/s from %s.\n", timer_freq, source->name);
+}
 
-  /* Refine the next 8 bits of loops_per_tick. */
-  high_bit = loops_per_tick;
-  for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-    if (!too_many_loops (high_bit | test_bit))
-      loops_per_tick |= test_bit;
+/* Starts the timer tick on the application processor that is
+   running, if every CPU has its own timer. */
+void
+timer_init_ap (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  if (source == &lapic_source)
+    source->start_periodic (tick_count);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -71,7 +189,27 @@ int64_t
 timer_ticks (void)
 {
   enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
+  int64_t t;
+
+  if (cpu_current () == &cpus[0])
+    t = ticks;
+  else
+    {
+      /* TICKS takes two loads to read.  The timer interrupt on
+         the BSP can update it between them, so retry until two
+         reads agree.  If the BSP is in tickless idle, add the
+         ticks that have passed without being counted. */
+      spin_lock (&idle_lock);
+      do
+        {
+          t = ticks;
+          barrier ();
+        }
+      while (t != ticks);
+      if (oneshot_ticks > 1)
+        t += idle_ticks_passed ();
+      spin_unlock (&idle_lock);
+    }
   intr_set_level (old_level);
   return t;
 }
@@ -90,10 +228,21 @@ void
 timer_sleep (int64_t ticks)
 {
   int64_t start = timer_ticks ();
+  struct timeout wakeup;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-
-  thread_sleep(start + ticks);
+  if (ticks <= 0)
+    return;
+
+  /* Hold sleep_lock until we are blocked, so that wake_sleeper()
+     on the BSP cannot try to wake us up first. */
+  old_level = intr_disable ();
+  spin_lock (&sleep_lock);
+  timeout_init (&wakeup, wake_sleeper, thread_current ());
+  timeout_add (&wakeup, start + ticks);
+  thread_block_unlock (&sleep_lock);
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -120,6 +269,46 @@ timer_nsleep (int64_t ns)
   real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by hrtimer_start() when a new hrtimer becomes the
+   earliest, with interrupts off, to make the timer interrupt
+   arrive in time for it.  Only the BSP receives timer
+   interrupts.  Another CPU wakes the BSP if it is idle, so that
+   it reconsiders its countdown; otherwise the BSP rearms the
+   timer at its next tick. */
+void
+timer_reprogram (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cpu_current () == &cpus[0])
+    arm_hrtimer ();
+  else if (cpus[0].curr == cpus[0].idle_thread)
+    cpu_kick (&cpus[0]);
+}
+
+/* Called by timeout_add(), with interrupts off, after adding a
+   timeout that expires at tick EXPIRES.  Only the BSP runs
+   timeouts, and in tickless idle it sleeps until the earliest
+   one that it knew of.  Another CPU therefore wakes the BSP if
+   the new timeout is due before the BSP's countdown ends, so that
+   the BSP reconsiders its countdown. */
+void
+timer_timeout_added (int64_t expires)
+{
+  bool kick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_nohz || cpu_current () == &cpus[0])
+    return;
+
+  spin_lock (&idle_lock);
+  kick = oneshot_ticks > 1 && expires < ticks + oneshot_ticks;
+  spin_unlock (&idle_lock);
+  if (kick)
+    cpu_kick (&cpus[0]);
+}
+
 /* Busy-waits for approximately MS milliseconds.  Interrupts need
    not be turned on.
 
@@ -166,60 +355,372 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic tick
+   by a single countdown that ends at the next timeout's
+   expiration, or as far ahead as the source's counter allows. */
+void
+timer_idle_enter (void)
+{
+  int64_t next, hr_next;
+  uint32_t first, limit;
+  int tick_cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Timeouts and hrtimers are run by the BSP, so only its tick
+     needs this care. */
+  if (!timer_nohz || oneshot_ticks != 0 || hr_rest != 0
+      || cpu_current () != &cpus[0])
+    return;
+
+  /* Hold idle_lock from reading the next timeout to starting the
+     countdown, so that timer_timeout_added() on another CPU sees
+     either the countdown or the timeout seen here. */
+  spin_lock (&idle_lock);
+  next = timeout_next_expiry (ticks + source->max_count / tick_count + 1);
+  tick_cnt = next - ticks;
+
+  /* Cycles left until the next periodic tick. */
+  first = source->read ();
+  if (first == 0 || first > tick_count)
+    first = tick_count;
+
+  /* End the countdown no later than the tick boundary before the
+     next hrtimer, which arm_hrtimer() then takes care of. */
+  limit = source->max_count;
+  hr_next = hrtimer_next_expiry ();
+  if (hr_next != INT64_MAX && ns_to_count (hr_next - clock_ns ()) < limit)
+    limit = ns_to_count (hr_next - clock_ns ());
+
+  while (tick_cnt > 1
+         && first + (uint64_t) (tick_cnt - 1) * tick_count > limit)
+    tick_cnt--;
+  if (tick_cnt > 1)
+    {
+      idle_first_ns = clock_ns ()
+                      + (uint64_t) first * NSEC_PER_SEC / source->hz;
+      start_oneshot (tick_cnt, first, first + (tick_cnt - 1) * tick_count);
+      spin_unlock (&idle_lock);
+    }
+  else
+    {
+      spin_unlock (&idle_lock);
+      arm_hrtimer ();
+    }
+}
+
+/* Called with interrupts off by intr_handler(), when an
+   interrupt arrives while the idle thread runs, and by the
+   scheduler, when the idle thread stops running.  If a tickless
+   countdown is still running, accounts for the idle ticks that
+   have passed and shortens the countdown to end at the next tick
+   boundary, where the timer interrupt handler resumes the
+   periodic tick.  The timeouts and hrtimers that came due are
+   left to the timer softirq, which runs when the interrupt
+   returns or, failing that, at the next interrupt. */
+void
+timer_idle_exit (void)
+{
+  uint32_t count, elapsed, rest;
+  int passed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0 || cpu_current () != &cpus[0])
+    return;
+
+  /* If the countdown already ended, its interrupt is pending and
+     will do the accounting. */
+  count = source->read ();
+  if (count == 0 || count > oneshot_count)
+    return;
+
+  elapsed = oneshot_count - count;
+  if (elapsed < oneshot_first)
+    {
+      passed = 0;
+      rest = oneshot_first - elapsed;
+    }
+  else
+    {
+      passed = 1 + (elapsed - oneshot_first) / tick_count;
+      rest = tick_count - (elapsed - oneshot_first) % tick_count;
+    }
+
+  spin_lock (&idle_lock);
+  start_oneshot (1, rest, rest);
+  while (passed-- > 0)
+    account_tick (true, false);
+  spin_unlock (&idle_lock);
+  softirq_raise (SOFTIRQ_TIMER);
+}
+
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
+{
+  if (cpu_current () != &cpus[0])
+    {
+      /* Another CPU's own tick only drives its own scheduling. */
+      thread_tick (from_user (args));
+      if (thread_mlfqs)
+        mlfqs_increment ();
+      if (profile_enabled)
+        profile_sample (args);
+      test_max_priority ();
+      return;
+    }
+
+  if (hr_rest != 0)
+    {
+      /* An hrtimer countdown ended between ticks.  Count down
+         the rest of the tick, unless another hrtimer is due
+         first. */
+      uint32_t rest = hr_rest;
+
+      hr_rest = 0;
+      start_oneshot (1, rest, rest);
+      softirq_raise (SOFTIRQ_TIMER);
+      test_max_priority ();
+      return;
+    }
+
+  if (oneshot_ticks != 0)
+    {
+      /* A tickless countdown ended.  All but the last tick it
+         covered were spent idle.  Resume the periodic tick, in
+         phase with the tick boundary that just passed. */
+      int idle_cnt = oneshot_ticks - 1;
+
+      spin_lock (&idle_lock);
+      oneshot_ticks = 0;
+      source->start_periodic (tick_count);
+      while (idle_cnt-- > 0)
+        account_tick (true, false);
+      spin_unlock (&idle_lock);
+    }
+  account_tick (false, from_user (args));
+  if (profile_enabled)
+    profile_sample (args);
+
+  softirq_raise (SOFTIRQ_TIMER);
+  test_max_priority ();
+}
+
+/* PIT interrupt handler.  Ignores an interrupt that was already
+   on its way when the tick moved to the local APIC. */
+static void
+pit_interrupt (struct intr_frame *args)
+{
+  if (source == &pit_source)
+    timer_interrupt (args);
+}
+
+/* Returns true if interrupt frame F interrupted code running
+   in user mode, at privilege level 3. */
+static bool
+from_user (const struct intr_frame *f)
+{
+  return (f->cs & 3) == 3;
+}
+
+/* Does the work of the BSP's timer interrupt that need not be
+   done with interrupts off: fires the timeouts and hrtimers that
+   are due, arms the timer for the next hrtimer, and once a second
+   updates the MLFQS statistics. */
+static void
+timer_softirq (void)
+{
+  enum intr_level old_level;
+
+  timeout_run (timer_ticks ());
+  hrtimer_run (clock_ns ());
+
+  old_level = intr_disable ();
+  arm_hrtimer ();
+  if (mlfqs_recalc_due)
+    {
+      /* Walking all the threads takes the thread list's spin
+         lock, so it must still be done with interrupts off. */
+      mlfqs_recalc_due = false;
+      mlfqs_load_avg ();
+      mlfqs_recalc ();
+    }
+  intr_set_level (old_level);
+
+  /* Threads woken above, such as EDF threads whose budgets were
+     replenished, may need to preempt the thread we interrupted. */
+  test_max_priority ();
+}
+
+/* Advances the tick count by one and does the per-tick
+   scheduler bookkeeping.  IDLE is true for ticks that passed in
+   tickless idle mode, for which no timer interrupt arrived.
+   Otherwise, USER is true if the timer interrupted user code. */
+static void
+account_tick (bool idle, bool user)
 {
   ticks++;
-  thread_tick ();
+  if (idle)
+    thread_idle_tick ();
+  else
+    thread_tick (user);
 
   if (thread_mlfqs)
   {
-    mlfqs_increment ();
-    if (timer_ticks () % TIMER_FREQ == 0)
+    if (!idle)
+      mlfqs_increment ();
+    if (ticks % timer_freq == 0)
     {
-      mlfqs_load_avg ();
-      mlfqs_recalc ();
+      mlfqs_recalc_due = true;
+      softirq_raise (SOFTIRQ_TIMER);
     }
-    if (timer_ticks () % 4 == 0)
+    if (!idle && ticks % mlfqs_priority_ticks == 0)
       mlfqs_priority (thread_current ());
   }
+}
+
+/* Puts the source in one-shot mode for a countdown of COUNT
+   cycles that spans TICK_CNT tick boundaries, the first one FIRST
+   cycles from now. */
+static void
+start_oneshot (int tick_cnt, uint32_t first, uint32_t count)
+{
+  ASSERT (tick_cnt > 0);
+  ASSERT (count > 0 && count <= source->max_count);
 
-  if (get_next_tick_to_awake () <= ticks)
-    thread_awake (ticks);
+  oneshot_ticks = tick_cnt;
+  oneshot_first = first;
+  oneshot_count = count;
+  source->start_oneshot (count);
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops)
+/* If the earliest hrtimer is due before the next tick boundary,
+   cuts the current tick short with a one-shot countdown that
+   ends when it is due.  Called on the BSP with interrupts off.
+   A tickless countdown over several ticks is left alone, because
+   timer_idle_enter() ended it before the hrtimer. */
+static void
+arm_hrtimer (void)
+{
+  int64_t expires;
+  uint32_t rest, count;
+
+  if (cpu_current () != &cpus[0] || oneshot_ticks > 1)
+    return;
+  expires = hrtimer_next_expiry ();
+  if (expires == INT64_MAX)
+    return;
+
+  /* Cycles left until the next tick boundary. */
+  rest = source->read ();
+  if (oneshot_ticks != 0 || hr_rest != 0)
+    {
+      /* If the countdown already ended, its interrupt is
+         pending and will rearm. */
+      if (rest == 0 || rest > oneshot_count)
+        return;
+      rest += hr_rest;
+    }
+  else if (rest == 0 || rest > tick_count)
+    rest = tick_count;
+
+  count = ns_to_count (expires - clock_ns ());
+  if (count >= rest)
+    return;
+  if (count == 0)
+    count = 1;
+
+  oneshot_ticks = 0;
+  hr_rest = rest - count;
+  oneshot_count = count;
+  source->start_oneshot (count);
+}
+
+/* Returns the number of source cycles in NS nanoseconds,
+   rounded up.  Spans longer than a second, or than the source
+   can count down in one go, are cut short. */
+static uint32_t
+ns_to_count (int64_t ns)
+{
+  uint64_t count;
+
+  if (ns <= 0)
+    return 0;
+  if (ns > NSEC_PER_SEC)
+    ns = NSEC_PER_SEC;
+  count = (ns * source->hz + NSEC_PER_SEC - 1) / NSEC_PER_SEC;
+  return count < source->max_count ? count : source->max_count;
+}
+
+/* Returns the number of tick boundaries that have passed during
+   the BSP's current tickless countdown, judging by clock_ns(),
+   but fewer than the countdown spans, since the timer interrupt
+   counts the last one itself.  idle_lock must be held. */
+static int
+idle_ticks_passed (void)
+{
+  int64_t now = clock_ns ();
+  int64_t passed;
+
+  if (now < idle_first_ns)
+    return 0;
+  passed = 1 + (now - idle_first_ns) / (NSEC_PER_SEC / timer_freq);
+  return passed < oneshot_ticks - 1 ? passed : oneshot_ticks - 1;
+}
+
+/* Starts the PIT's periodic tick.  The PIT computes COUNT
+   itself, the same way timer_init() does. */
+static void
+pit_periodic (uint32_t count UNUSED)
 {
-  /* Wait for a timer tick. */
-  int64_t start = ticks;
-  while (ticks == start)
-    barrier ();
+  pit_configure_channel (0, 2, timer_freq);
+}
 
-  /* Run LOOPS loops. */
-  start = ticks;
-  busy_wait (loops);
+/* Starts a PIT countdown of COUNT cycles. */
+static void
+pit_oneshot (uint32_t count)
+{
+  pit_start_countdown (0, count);
+}
 
-  /* If the tick count changed, we iterated too long. */
-  barrier ();
-  return start != ticks;
+/* Returns the cycles left in the PIT's period or countdown. */
+static uint32_t
+pit_read (void)
+{
+  return pit_read_counter (0);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Timeout function used by timer_sleep() to wake up sleeping
+   thread T. */
+static void
+wake_sleeper (void *t)
+{
+  enum intr_level old_level;
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops)
+  old_level = intr_disable ();
+  spin_lock (&sleep_lock);
+  thread_unblock (t);
+  spin_unlock (&sleep_lock);
+  intr_set_level (old_level);
+}
+
+/* Sleeps for NS nanoseconds, less than a timer tick, by
+   blocking until an hrtimer expires. */
+static void
+hr_sleep (int64_t ns)
 {
-  while (loops-- > 0)
-    barrier ();
+  struct hrtimer wakeup;
+  enum intr_level old_level;
+
+  /* As in timer_sleep(), hold sleep_lock until we are blocked. */
+  old_level = intr_disable ();
+  spin_lock (&sleep_lock);
+  hrtimer_init (&wakeup, wake_sleeper, thread_current ());
+  hrtimer_start (&wakeup, clock_ns () + ns);
+  thread_block_unlock (&sleep_lock);
+  intr_set_level (old_level);
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -229,12 +730,14 @@ real_time_sleep (int64_t num, int32_t denom)
   /* Convert NUM/DENOM seconds into timer ticks, rounding down.
 
         (NUM / DENOM) s
-     ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-     1 s / TIMER_FREQ ticks
+     ---------------------- = NUM * timer_freq / DENOM ticks.
+     1 s / timer_freq ticks
   */
-  int64_t ticks = num * TIMER_FREQ / denom;
+  int64_t ticks = num * timer_freq / denom;
+  int64_t ns = num * (NSEC_PER_SEC / denom);
 
   ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (NSEC_PER_SEC % denom == 0);
   if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
@@ -242,10 +745,15 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */
       timer_sleep (ticks);
     }
+  else if (ns >= HR_SLEEP_MIN_NS)
+    {
+      /* Otherwise, an hrtimer gives sub-tick timing and still
+         yields the CPU. */
+      hr_sleep (ns);
+    }
   else
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
+      /* Too short to be worth blocking. */
       real_time_delay (num, denom);
     }
 }
@@ -254,8 +762,10 @@ real_time_sleep (int64_t num, int32_t denom)
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
-  /* Scale the numerator and denominator down by 1000 to avoid
-     the possibility of overflow. */
-  ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+  uint64_t end;
+
+  ASSERT (NSEC_PER_SEC % denom == 0);
+  end = rdtsc () + clock_ns_to_tsc (num * (NSEC_PER_SEC / denom));
+  while (rdtsc () < end)
+    asm volatile ("pause");
 }
@@ -2,13 +2,31 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Range and default of the number of timer interrupts per
+   second. */
+#define TIMER_FREQ_MIN 100
+#define TIMER_FREQ_MAX 1000
+#define TIMER_FREQ_DEFAULT 100
+
+/* Number of timer interrupts per second.
+   Controlled by kernel command-line option "-hz=N". */
+extern int timer_freq;
+
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-nohz". */
+extern bool timer_nohz;
+
+/* If true, use the PIT for the timer tick even if there is a
+   local APIC.  Controlled by kernel command-line option
+   "-pit". */
+extern bool timer_pit;
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_init_ap (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
@@ -24,6 +42,14 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Tickless idle support, for the idle thread. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+void timer_timeout_added (int64_t expires);
+
 void timer_print_stats (void);
 
+/* For use by devices/hrtimer.c. */
+void timer_reprogram (void);
+
 #endif /* devices/timer.h */
@@ -0,0 +1,221 @@
+/* Priority queue.
+
+   See heap.h for basic information.  Orphaned children are
+   melded with the usual two-pass pairing. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+                               struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes H as an empty heap that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->next_seq = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H.  Takes constant time. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  e->seq = h->next_seq++;
+  h->root = meld (h, h->root, e);
+  h->elem_cnt++;
+}
+
+/* Removes the maximum element from H and returns it.  H must not
+   be empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *e = heap_top (h);
+
+  heap_remove (h, e);
+  return e;
+}
+
+/* Returns the maximum element in H without removing it.  H must
+   not be empty.  Takes constant time. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  ASSERT (h != NULL);
+  ASSERT (h->root != NULL);
+
+  return h->root;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *children;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+  ASSERT (h->elem_cnt > 0);
+
+  children = merge_pairs (h, e->child);
+  if (e == h->root)
+    h->root = children;
+  else
+    {
+      cut (e);
+      h->root = meld (h, h->root, children);
+    }
+  h->elem_cnt--;
+}
+
+/* Restores the heap order of H after the value of E, which must
+   be in H, has increased, or stayed the same.  Takes constant
+   time. */
+void
+heap_increase (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  if (e != h->root)
+    {
+      cut (e);
+      h->root = meld (h, h->root, e);
+    }
+}
+
+/* Restores the heap order of H after the value of E, which must
+   be in H, has changed in either direction.  E keeps its place
+   among elements equal to it. */
+void
+heap_update (struct heap *h, struct heap_elem *e)
+{
+  heap_remove (h, e);
+  e->child = NULL;
+  h->root = meld (h, h->root, e);
+  h->elem_cnt++;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->root == NULL;
+}
+
+/* Returns true if A should be popped before B from H. */
+static inline bool
+before (struct heap *h, const struct heap_elem *a, const struct heap_elem *b)
+{
+  if (h->less (b, a, h->aux))
+    return true;
+  else if (h->less (a, b, h->aux))
+    return false;
+  else
+    return (int) (a->seq - b->seq) < 0;
+}
+
+/* Melds the trees rooted at A and B, either of which may be a
+   null pointer, by making the root that comes later a child of
+   the other, and returns the new root.  A and B must not have
+   siblings. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  struct heap_elem *tmp;
+
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (before (h, b, a))
+    {
+      tmp = a;
+      a = b;
+      b = tmp;
+    }
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of sibling trees that starts at FIRST into one
+   tree and returns its root, or a null pointer if FIRST is a
+   null pointer.  The first pass melds the trees in pairs from
+   left to right; the second melds the pairs from right to
+   left. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;       /* Linked through `next', last first. */
+  struct heap_elem *root = NULL;
+
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = meld (h, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = meld (h, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
+
+/* Detaches E, which must not be a root, and its subtree from
+   E's parent and siblings. */
+static void
+cut (struct heap_elem *e)
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
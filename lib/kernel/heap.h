@@ -0,0 +1,78 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+
+   This is a pairing heap: a heap-ordered tree of any shape, in
+   which each element keeps a list of its children.  Pushing an
+   element or raising an element's key melds it with the root in
+   constant time.  Popping the maximum element or removing an
+   arbitrary element pairs up the orphaned children, taking
+   O(lg n) amortized time.  See M. L. Fredman et al., "The Pairing
+   Heap: A New Form of Self-Adjusting Heap," Algorithmica 1
+   (1986), for details.
+
+   Like the linked list and hash table implementations, the heap
+   does not use dynamic allocation.  Each structure that can
+   potentially be in a heap must embed a struct heap_elem member,
+   and the heap_entry macro converts a struct heap_elem back to
+   the structure object that contains it.  Refer to
+   lib/kernel/list.h for a detailed explanation of the technique.
+
+   The heap pops its maximum element first.  Elements that
+   compare equal are popped in the order they were pushed, so a
+   heap of elements that all compare equal acts as a FIFO
+   queue. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* First child, or null pointer. */
+    struct heap_elem *next;     /* Next sibling, or null pointer. */
+    struct heap_elem *prev;     /* Previous sibling, else parent. */
+    unsigned seq;               /* Order of insertion, for ties. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child            \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Maximum element, or null pointer. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    unsigned next_seq;          /* Sequence number for next push. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+struct heap_elem *heap_top (const struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+void heap_increase (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
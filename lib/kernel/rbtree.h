@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   balanced, so that insertion and removal take O(lg n) time in
+   the worst case.  This implementation also keeps track of the
+   minimum element, so that finding it takes constant time, which
+   suits a tree used as a priority queue.
+
+   Like the linked list and hash table implementations, the tree
+   does not use dynamic allocation.  Each structure that can
+   potentially be in a tree must embed a struct rb_elem member,
+   and the rb_entry macro converts a struct rb_elem back to the
+   structure object that contains it.  Refer to lib/kernel/list.h
+   for a detailed explanation of the technique.
+
+   Elements that compare equal are kept in insertion order: a new
+   element goes after all the elements equal to it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null pointer at the root. */
+    struct rb_elem *left;       /* Left child, or null pointer. */
+    struct rb_elem *right;      /* Right child, or null pointer. */
+    bool red;                   /* Red node?  Otherwise black. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree
+  {
+    struct rb_elem *root;       /* Root, or null pointer if empty. */
+    struct rb_elem *min;        /* Minimum element, or null pointer. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rbtree_init (struct rbtree *, rb_less_func *, void *aux);
+
+void rbtree_insert (struct rbtree *, struct rb_elem *);
+void rbtree_remove (struct rbtree *, struct rb_elem *);
+
+struct rb_elem *rbtree_min (const struct rbtree *);
+struct rb_elem *rbtree_next (struct rb_elem *);
+
+size_t rbtree_size (const struct rbtree *);
+bool rbtree_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,27 @@
+#ifndef __LIB_SCHEDGROUP_H
+#define __LIB_SCHEDGROUP_H
+
+/* Parameters of a scheduling group, as set by the kernel's
+   schedgroup_set() and the system call of the same name.
+
+   Under the completely fair scheduler, the CPU is first divided
+   among the groups that have threads ready to run, in proportion
+   to their weights, and then among the threads in each group.
+   Independently of the scheduler, a group with a nonzero quota
+   may use at most QUOTA timer ticks of CPU time, summed over all
+   of its threads, in each PERIOD ticks.  Once it has, its threads
+   are parked until the period ends. */
+struct schedgroup_params
+  {
+    int weight;                 /* Share of the CPU, relative to others. */
+    int quota;                  /* Ticks per period, or 0 for no limit. */
+    int period;                 /* Length of a period, in ticks. */
+  };
+
+/* Range and default of a group's weight.  The default is the
+   weight of a single thread with nice value 0. */
+#define SCHEDGROUP_WEIGHT_MIN 1
+#define SCHEDGROUP_WEIGHT_DEFAULT 1024
+#define SCHEDGROUP_WEIGHT_MAX 100000
+
+#endif /* lib/schedgroup.h */
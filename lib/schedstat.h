@@ -0,0 +1,32 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Scheduling statistics for one thread, kept by the kernel and
+   returned to user programs by the schedstat() system call.
+
+   A thread is "waiting" whenever it is ready to run but not
+   running, whether because it was just woken up or because it
+   was preempted.  Each wakeup is also timed separately, from the
+   moment the thread is unblocked to the moment it runs: a thread
+   that spends most of its life waiting is starved for CPU, while
+   one with few ticks and little waiting is mostly blocked.
+
+   Times are in nanoseconds. */
+struct schedstat
+  {
+    int64_t user_ticks;         /* Timer ticks spent in user mode. */
+    int64_t kernel_ticks;       /* Timer ticks spent in kernel mode. */
+    int64_t run_cnt;            /* Times put on a CPU. */
+    int64_t voluntary_cnt;      /* Times switched out by blocking. */
+    int64_t involuntary_cnt;    /* Times switched out while runnable. */
+    int64_t wait_ns;            /* Total time waiting to run. */
+    int64_t wait_max_ns;        /* Longest single wait. */
+    int64_t wakeup_cnt;         /* Times woken up. */
+    int64_t wakeup_ns;          /* Total time from wakeup to running. */
+    int64_t wakeup_max_ns;      /* Longest time from wakeup to running. */
+    int64_t pd_load_cnt;        /* Times its page directory was loaded. */
+  };
+
+#endif /* lib/schedstat.h */
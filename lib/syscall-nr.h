@@ -28,7 +28,13 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SCHEDSTAT,              /* Obtain a process's scheduling statistics. */
+    SYS_SCHEDGROUP_CREATE,      /* Create a scheduling group. */
+    SYS_SCHEDGROUP_JOIN,        /* Move the process into a scheduling group. */
+    SYS_SCHEDGROUP_SET          /* Set a scheduling group's weight and quota. */
   };
 
 #endif /* lib/syscall-nr.h */
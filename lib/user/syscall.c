@@ -182,3 +182,27 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+schedstat (pid_t pid, struct schedstat *stats)
+{
+  return syscall2 (SYS_SCHEDSTAT, pid, stats);
+}
+
+int
+schedgroup_create (void)
+{
+  return syscall0 (SYS_SCHEDGROUP_CREATE);
+}
+
+bool
+schedgroup_join (int group)
+{
+  return syscall1 (SYS_SCHEDGROUP_JOIN, group);
+}
+
+bool
+schedgroup_set (int group, const struct schedgroup_params *params)
+{
+  return syscall2 (SYS_SCHEDGROUP_SET, group, params);
+}
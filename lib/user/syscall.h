@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <schedgroup.h>
+#include <schedstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,12 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions.  schedstat() takes 0 for the calling process.
+   Scheduling group 0 is the root group.  A process may set and
+   join only the groups it created, and join the root group. */
+bool schedstat (pid_t, struct schedstat *);
+int schedgroup_create (void);
+bool schedgroup_join (int group);
+bool schedgroup_set (int group, const struct schedgroup_params *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,185 @@
+/* Benchmark for the page allocator in threads/palloc.c.
+
+   Times single-page allocations and frees, and allocations of
+   zeroed pages after giving the idle thread time to zero pages
+   in advance, checking that they really are zeroed.  Then runs a
+   long sequence of allocations and frees of random sizes and
+   reports how the kernel pool is broken up by it and how long
+   each operation took.  Once everything has been freed again, the
+   pool must have merged back into the blocks it started with.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Number of single-page allocations to time. */
+#define SINGLE_CNT 1000
+
+/* Number of zeroed pages to allocate at once. */
+#define ZERO_CNT 32
+
+/* Number of allocations live at once in the mixed run, the
+   number of steps in it, and the largest allocation in it, in
+   pages. */
+#define SLOT_CNT 64
+#define STEP_CNT 20000
+#define MAX_PAGES 8
+
+/* An allocation in the mixed run. */
+struct slot
+  {
+    void *pages;                /* First page, or null if none. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static void test_single (void);
+static void test_zero (void);
+static void test_mixed (void);
+static size_t largest_allocation (void);
+
+/* Benchmarks the page allocator. */
+void
+test (void)
+{
+  test_single ();
+  test_zero ();
+  test_mixed ();
+}
+
+/* Times SINGLE_CNT pairs of single-page allocations and frees. */
+static void
+test_single (void)
+{
+  uint64_t get_cycles = 0, free_cycles = 0;
+  int i;
+
+  for (i = 0; i < SINGLE_CNT; i++)
+    {
+      uint64_t start = rdtsc ();
+      void *page = palloc_get_page (PAL_ASSERT);
+      get_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      palloc_free_page (page);
+      free_cycles += rdtsc () - start;
+    }
+  printf ("single pages: %"PRIu64" cycles per get, "
+          "%"PRIu64" per free\n",
+          get_cycles / SINGLE_CNT, free_cycles / SINGLE_CNT);
+}
+
+/* Sleeps to let the idle thread zero pages in advance, then
+   times ZERO_CNT allocations of zeroed pages, checking each
+   page's contents. */
+static void
+test_zero (void)
+{
+  static void *pages[ZERO_CNT];
+  uint64_t get_cycles = 0;
+  int i;
+
+  timer_msleep (100);
+  for (i = 0; i < ZERO_CNT; i++)
+    {
+      uint64_t start = rdtsc ();
+      uint32_t *page = pages[i] = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      size_t j;
+
+      get_cycles += rdtsc () - start;
+      for (j = 0; j < PGSIZE / sizeof *page; j++)
+        ASSERT (page[j] == 0);
+    }
+  for (i = 0; i < ZERO_CNT; i++)
+    palloc_free_page (pages[i]);
+  printf ("zeroed pages: %"PRIu64" cycles per get\n",
+          get_cycles / ZERO_CNT);
+}
+
+/* Allocates and frees pages at random, keeping up to SLOT_CNT
+   allocations of 1 to MAX_PAGES pages live, and reports the
+   resulting fragmentation. */
+static void
+test_mixed (void)
+{
+  static struct slot slots[SLOT_CNT];
+  uint64_t get_cycles = 0, free_cycles = 0;
+  size_t get_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  size_t before;
+  int i;
+
+  random_init (0);
+  before = largest_allocation ();
+  printf ("before: largest allocation %zu pages\n", before);
+  palloc_print_pools ();
+
+  for (i = 0; i < STEP_CNT; i++)
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+      uint64_t start = rdtsc ();
+
+      if (s->pages != NULL)
+        {
+          palloc_free_multiple (s->pages, s->page_cnt);
+          free_cycles += rdtsc () - start;
+          free_cnt++;
+          s->pages = NULL;
+        }
+      else
+        {
+          s->page_cnt = random_ulong () % MAX_PAGES + 1;
+          s->pages = palloc_get_multiple (0, s->page_cnt);
+          get_cycles += rdtsc () - start;
+          if (s->pages != NULL)
+            get_cnt++;
+          else
+            fail_cnt++;
+        }
+    }
+
+  printf ("mixed: %zu gets, %"PRIu64" cycles each, %zu failed\n",
+          get_cnt, get_cnt ? get_cycles / get_cnt : 0, fail_cnt);
+  printf ("mixed: %zu frees, %"PRIu64" cycles each\n",
+          free_cnt, free_cnt ? free_cycles / free_cnt : 0);
+  printf ("fragmented: largest allocation %zu pages\n",
+          largest_allocation ());
+  palloc_print_pools ();
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      {
+        palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+        slots[i].pages = NULL;
+      }
+  ASSERT (largest_allocation () == before);
+  printf ("after: largest allocation %zu pages\n", before);
+}
+
+/* Returns the largest power-of-2 number of pages that can be
+   allocated from the kernel pool. */
+static size_t
+largest_allocation (void)
+{
+  size_t page_cnt;
+
+  for (page_cnt = (size_t) 1 << 19; page_cnt > 0; page_cnt /= 2)
+    {
+      void *pages = palloc_get_multiple (0, page_cnt);
+      if (pages != NULL)
+        {
+          palloc_free_multiple (pages, page_cnt);
+          break;
+        }
+    }
+  return page_cnt;
+}
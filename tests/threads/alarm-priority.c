@@ -21,7 +21,7 @@ test_alarm_priority (void)
   /* This test does not work with the MLFQS. */
   ASSERT (!thread_mlfqs);
 
-  wake_time = timer_ticks () + 5 * TIMER_FREQ;
+  wake_time = timer_ticks () + 5 * timer_freq;
   sema_init (&wait_sema, 0);
   
   for (i = 0; i < 10; i++) 
@@ -0,0 +1,73 @@
+/* Checks that timer_usleep() for less than a timer tick blocks
+   instead of busy-waiting, and that it sleeps about as long as
+   asked.
+
+   The main thread starts a thread at PRI_MIN that counts in a
+   loop, then sleeps SLEEP_CNT times for SLEEP_US microseconds.
+   With one CPU, the counting thread can only run while the main
+   thread is asleep.  Each sleep should last at least SLEEP_US
+   microseconds, and on average end well before the next timer
+   tick would have. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 10
+#define SLEEP_US 1000
+
+static thread_func counter_thread_func;
+
+static volatile unsigned counter;
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_alarm_usleep (void)
+{
+  int64_t total = 0;
+  int i;
+
+  ASSERT (SLEEP_US * 1000 < NSEC_PER_SEC / timer_freq);
+
+  counter = 0;
+  stop = false;
+  sema_init (&done, 0);
+  thread_create ("counter", PRI_MIN, counter_thread_func, NULL);
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      unsigned start_count = counter;
+      int64_t start = clock_ns ();
+      int64_t elapsed;
+
+      timer_usleep (SLEEP_US);
+      elapsed = clock_ns () - start;
+      if (elapsed < SLEEP_US * 1000)
+        fail ("sleep %d lasted only %d us.", i, (int) (elapsed / 1000));
+      if (counter == start_count)
+        fail ("counter thread did not run during sleep %d.", i);
+      total += elapsed;
+    }
+  if (total / SLEEP_CNT >= NSEC_PER_SEC / timer_freq)
+    fail ("sleeps of %d us took %d us on average.",
+          SLEEP_US, (int) (total / SLEEP_CNT / 1000));
+  msg ("%d sleeps of %d us each let another thread run.",
+       SLEEP_CNT, SLEEP_US);
+
+  stop = true;
+  sema_down (&done);
+  pass ();
+}
+
+static void
+counter_thread_func (void *aux UNUSED)
+{
+  while (!stop)
+    counter++;
+  sema_up (&done);
+}
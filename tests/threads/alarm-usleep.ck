@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) 10 sleeps of 1000 us each let another thread run.
+(alarm-usleep) end
+EOF
+pass;
@@ -1,27 +1,51 @@
 /* Creates N threads, each of which sleeps a different, fixed
    duration, M times.  Records the wake-up order and verifies
-   that it is valid. */
+   that it is valid, and that no thread woke up early. */
 
+#include <inttypes.h>
 #include <stdio.h>
 #include "tests/threads/tests.h"
+#include "threads/cpu.h"
 #include "threads/init.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "devices/timer.h"
 
-static void test_sleep (int thread_cnt, int iterations);
+static void test_sleep (int thread_cnt, int iterations, int max_late);
 
 void
 test_alarm_single (void) 
 {
-  test_sleep (5, 1);
+  test_sleep (5, 1, -1);
 }
 
 void
 test_alarm_multiple (void) 
 {
-  test_sleep (5, 7);
+  test_sleep (5, 7, -1);
+}
+
+/* Like alarm-multiple, but with the sleepers spread over more
+   than one CPU, so that they go to sleep and wake up on CPUs
+   other than the one that runs the timer interrupt. */
+void
+test_alarm_multiple_smp (void)
+{
+  if (cpu_cnt < 2)
+    fail ("needs more than one CPU; run with -smp=2.");
+  test_sleep (5, 7, -1);
+}
+
+/* Like alarm-multiple, but with tickless idle, so that the timer
+   interrupt is stopped while every thread sleeps.  Each thread
+   must still wake up within a tick of its wake-up time. */
+void
+test_alarm_multiple_nohz (void)
+{
+  if (!timer_nohz)
+    fail ("needs tickless idle; run with -nohz.");
+  test_sleep (5, 7, 1);
 }
 
 /* Information about the test. */
@@ -42,13 +66,17 @@ struct sleep_thread
     int id;                     /* Sleeper ID. */
     int duration;               /* Number of ticks to sleep. */
     int iterations;             /* Iterations counted so far. */
+    int64_t min_late;           /* Fewest ticks woken up late. */
+    int64_t max_late;           /* Most ticks woken up late. */
   };
 
 static void sleeper (void *);
 
-/* Runs THREAD_CNT threads thread sleep ITERATIONS times each. */
+/* Runs THREAD_CNT threads thread sleep ITERATIONS times each.
+   If MAX_LATE is nonnegative, each wake-up must come at most
+   MAX_LATE ticks after the time asked for. */
 static void
-test_sleep (int thread_cnt, int iterations) 
+test_sleep (int thread_cnt, int iterations, int max_late) 
 {
   struct sleep_test test;
   struct sleep_thread *threads;
@@ -74,7 +102,7 @@ test_sleep (int thread_cnt, int iterations)
   /* Initialize test. */
   test.start = timer_ticks () + 100;
   test.iterations = iterations;
-  lock_init (&test.output_lock);
+  lock_init (&test.output_lock, "output");
   test.output_pos = output;
 
   /* Start threads. */
@@ -88,6 +116,8 @@ test_sleep (int thread_cnt, int iterations)
       t->id = i;
       t->duration = (i + 1) * 10;
       t->iterations = 0;
+      t->min_late = INT64_MAX;
+      t->max_late = INT64_MIN;
 
       snprintf (name, sizeof name, "thread %d", i);
       thread_create (name, PRI_DEFAULT, sleeper, t);
@@ -127,6 +157,15 @@ test_sleep (int thread_cnt, int iterations)
     if (threads[i].iterations != iterations)
       fail ("thread %d woke up %d times instead of %d",
             i, threads[i].iterations, iterations);
+
+  /* Verify that the wakeups came on time. */
+  for (i = 0; i < thread_cnt; i++)
+    if (threads[i].min_late < 0)
+      fail ("thread %d woke up %"PRId64" ticks early",
+            i, -threads[i].min_late);
+    else if (max_late >= 0 && threads[i].max_late > max_late)
+      fail ("thread %d woke up %"PRId64" ticks late",
+            i, threads[i].max_late);
   
   lock_release (&test.output_lock);
   free (output);
@@ -144,9 +183,16 @@ sleeper (void *t_)
   for (i = 1; i <= test->iterations; i++) 
     {
       int64_t sleep_until = test->start + i * t->duration;
+      int64_t late;
+
       timer_sleep (sleep_until - timer_ticks ());
+      late = timer_ticks () - sleep_until;
       lock_acquire (&test->output_lock);
       *test->output_pos++ = t->id;
+      if (late < t->min_late)
+        t->min_late = late;
+      if (late > t->max_late)
+        t->max_late = late;
       lock_release (&test->output_lock);
     }
 }
@@ -0,0 +1,96 @@
+/* Checks that the completely fair scheduler divides the CPU
+   among threads in proportion to the weights of their nice
+   values.
+
+   The cfs-fair-3 test runs 3 threads all niced to 0, which
+   should receive the same number of ticks.  The cfs-nice-3 test
+   runs 3 threads with nice 0, 5, and 10, whose weights are 1024,
+   335, and 110, so they should receive 697, 228, and 75 ticks out
+   of every 1,000.  Each test lets the threads spin for 10 seconds,
+   so the ticks should sum to approximately 10 * 100 == 1000
+   ticks. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_cfs_fair (int thread_cnt, int nice_step);
+
+void
+test_cfs_fair_3 (void)
+{
+  test_cfs_fair (3, 0);
+}
+
+void
+test_cfs_nice_3 (void)
+{
+  test_cfs_fair (3, 5);
+}
+
+#define MAX_THREAD_CNT 3
+
+struct thread_info
+  {
+    int64_t start_time;
+    int tick_count;
+    int nice;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_cfs_fair (int thread_cnt, int nice_step)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_cfs);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++)
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->nice = i * nice_step;
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep (12 * timer_freq);
+
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_)
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 1 * timer_freq;
+  int64_t spin_time = sleep_time + 10 * timer_freq;
+  int64_t last_time = 0;
+
+  thread_set_nice (ti->nice);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,122 @@
+/* Checks that the completely fair scheduler divides the CPU
+   among scheduling groups first, and that group quotas hold.
+
+   The cfs-group-4 test runs 1 thread in one group and 3 threads
+   in another, both of the default weight.  The first thread
+   should receive 500 ticks out of every 1,000, and the others
+   167 each, because each group gets half of the CPU.  The
+   cfs-group-quota test runs 2 threads in groups of their own,
+   the first with a quota of 1 tick in every 4.  It should
+   receive 250 ticks out of every 1,000, and the other thread the
+   remaining 750.  Each test lets the threads spin for 10 seconds,
+   so the ticks should sum to approximately 10 * 100 == 1000
+   ticks. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/schedgroup.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_THREAD_CNT 4
+
+struct thread_info
+  {
+    int64_t start_time;
+    int tick_count;
+    int group;
+  };
+
+static void test_cfs_group (int thread_cnt, const int group_of[],
+                            int quota);
+static void load_thread (void *aux);
+
+void
+test_cfs_group_4 (void)
+{
+  static const int group_of[] = {0, 1, 1, 1};
+  test_cfs_group (4, group_of, 0);
+}
+
+void
+test_cfs_group_quota (void)
+{
+  static const int group_of[] = {0, 1};
+  test_cfs_group (2, group_of, 1);
+}
+
+/* Runs THREAD_CNT threads, thread I in the group numbered
+   GROUP_OF[I].  If QUOTA is nonzero, group 0 may use QUOTA ticks
+   in every 4. */
+static void
+test_cfs_group (int thread_cnt, const int group_of[], int quota)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int groups[2];
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_cfs);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  for (i = 0; i < 2; i++)
+    {
+      groups[i] = schedgroup_create ();
+      if (groups[i] < 0)
+        fail ("schedgroup_create() failed.");
+    }
+  if (quota != 0)
+    {
+      struct schedgroup_params params;
+
+      params.weight = SCHEDGROUP_WEIGHT_DEFAULT;
+      params.quota = quota;
+      params.period = 4;
+      if (!schedgroup_set (groups[0], &params))
+        fail ("schedgroup_set() failed.");
+    }
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++)
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->group = groups[group_of[i]];
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep (12 * timer_freq);
+
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_)
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 1 * timer_freq;
+  int64_t spin_time = sleep_time + 10 * timer_freq;
+  int64_t last_time = 0;
+
+  if (!schedgroup_join (ti->group))
+    fail ("schedgroup_join() failed.");
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,68 @@
+/* Checks admission control for EDF threads.
+
+   thread_create_edf() must admit EDF threads up to the default
+   bound of 90% utilization, refuse one that would exceed it, and
+   admit it again once utilization has been released by threads
+   that exited. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func waiter;
+
+static struct semaphore release, exited;
+
+/* Creates an EDF thread that runs RUNTIME ticks every PERIOD
+   ticks and waits for `release', and reports whether it was
+   admitted. */
+static bool
+create (int runtime, int period)
+{
+  bool admitted = thread_create_edf ("waiter", runtime, period,
+                                     waiter, NULL) != TID_ERROR;
+  msg ("%d/%d: %s", runtime, period, admitted ? "admitted" : "refused");
+  return admitted;
+}
+
+void
+test_edf_admit (void)
+{
+  int cnt = 0;
+
+  if (thread_edf_bound != 90)
+    fail ("test requires the default -edf-bound.");
+
+  sema_init (&release, 0);
+  sema_init (&exited, 0);
+
+  cnt += create (5, 10);
+  cnt += create (3, 10);
+  cnt += create (2, 10);
+  cnt += create (1, 10);
+  cnt += create (1, 100);
+
+  msg ("releasing %d threads", cnt);
+  while (cnt-- > 0)
+    {
+      sema_up (&release);
+      sema_down (&exited);
+    }
+
+  /* Give the last thread time to finish exiting. */
+  timer_sleep (1);
+  if (create (9, 10))
+    {
+      sema_up (&release);
+      sema_down (&exited);
+    }
+}
+
+static void
+waiter (void *aux UNUSED)
+{
+  sema_down (&release);
+  sema_up (&exited);
+}
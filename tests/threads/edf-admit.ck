@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) 5/10: admitted
+(edf-admit) 3/10: admitted
+(edf-admit) 2/10: refused
+(edf-admit) 1/10: admitted
+(edf-admit) 1/100: refused
+(edf-admit) releasing 3 threads
+(edf-admit) 9/10: admitted
+(edf-admit) end
+EOF
+pass;
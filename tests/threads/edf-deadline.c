@@ -0,0 +1,116 @@
+/* Checks that EDF threads meet their deadlines under load, and
+   that an EDF thread that never blocks is held to its budget.
+
+   Thread A needs 1 tick of CPU time in every 10 ticks and thread
+   B needs 2 ticks in every 20.  Each of them does that much work
+   in each period and then sleeps until the next one begins,
+   which must always be before its deadline.  Meanwhile, a greedy
+   EDF thread with a budget of 2 ticks in every 10 tries to use
+   the CPU all the time, and the main thread, a normal thread,
+   keeps busy too.  The greedy thread must not get more than its
+   budget, and the main thread must still get some CPU time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct periodic
+  {
+    int work;                   /* Ticks of work per period. */
+    int period;                 /* Period in ticks. */
+    int cnt;                    /* Number of periods to run. */
+    int met;                    /* Number of deadlines met. */
+  };
+
+static thread_func periodic_thread;
+static thread_func greedy_thread;
+
+static struct semaphore done;
+static volatile int finished;
+static volatile int64_t greedy_ticks, greedy_elapsed;
+
+void
+test_edf_deadline (void)
+{
+  struct periodic a = {1, 10, 10, 0};
+  struct periodic b = {2, 20, 5, 0};
+  int64_t main_ticks;
+
+  sema_init (&done, 0);
+  if (thread_create_edf ("greedy", 2, 10, greedy_thread, NULL) == TID_ERROR
+      || thread_create_edf ("a", a.work + 2, a.period,
+                            periodic_thread, &a) == TID_ERROR
+      || thread_create_edf ("b", b.work + 2, b.period,
+                            periodic_thread, &b) == TID_ERROR)
+    fail ("thread_create_edf() failed.");
+
+  /* Keep the CPU busy until A and B are done. */
+  main_ticks = thread_current ()->stats.kernel_ticks;
+  while (finished < 2)
+    continue;
+  main_ticks = thread_current ()->stats.kernel_ticks - main_ticks;
+  sema_down (&done);
+  sema_down (&done);
+  sema_down (&done);
+
+  msg ("thread a met %d of %d deadlines.", a.met, a.cnt);
+  msg ("thread b met %d of %d deadlines.", b.met, b.cnt);
+  if (greedy_ticks > (greedy_elapsed / 10 + 1) * 2)
+    fail ("greedy thread ran %lld ticks in %lld ticks.",
+          greedy_ticks, greedy_elapsed);
+  msg ("greedy thread stayed within its budget.");
+  if (main_ticks == 0)
+    fail ("main thread did not run.");
+  msg ("main thread was not starved.");
+}
+
+/* Does P->work ticks of work in each of P->cnt periods and
+   counts the deadlines met.  The thread's budget leaves two
+   ticks to spare for the granularity of the timer tick. */
+static void
+periodic_thread (void *p_)
+{
+  struct periodic *p = p_;
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < p->cnt; i++)
+    {
+      int64_t deadline = t->edf_deadline;
+      int64_t start = t->stats.kernel_ticks;
+
+      while (t->stats.kernel_ticks - start < p->work)
+        barrier ();
+      if (timer_ticks () < deadline)
+        p->met++;
+
+      /* Sleep until the next period begins. */
+      timer_sleep (deadline - timer_ticks ());
+    }
+
+  /* Increment with interrupts off, so that the other periodic
+     thread cannot preempt us between the read and the write. */
+  old_level = intr_disable ();
+  finished++;
+  intr_set_level (old_level);
+  sema_up (&done);
+}
+
+/* Uses as much CPU time as it gets until the periodic threads
+   are done. */
+static void
+greedy_thread (void *aux UNUSED)
+{
+  struct thread *t = thread_current ();
+  int64_t start = timer_ticks ();
+
+  while (finished < 2)
+    continue;
+  greedy_elapsed = timer_ticks () - start;
+  greedy_ticks = t->stats.kernel_ticks;
+  sema_up (&done);
+}
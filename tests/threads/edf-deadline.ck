@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) thread a met 10 of 10 deadlines.
+(edf-deadline) thread b met 5 of 5 deadlines.
+(edf-deadline) greedy thread stayed within its budget.
+(edf-deadline) main thread was not starved.
+(edf-deadline) end
+EOF
+pass;
@@ -127,11 +127,11 @@ test_mlfqs_load_60 (void)
       thread_create (name, PRI_DEFAULT, load_thread, NULL);
     }
   msg ("Starting threads took %d seconds.",
-       timer_elapsed (start_time) / TIMER_FREQ);
+       timer_elapsed (start_time) / timer_freq);
   
   for (i = 0; i < 90; i++) 
     {
-      int64_t sleep_until = start_time + TIMER_FREQ * (2 * i + 10);
+      int64_t sleep_until = start_time + timer_freq * (2 * i + 10);
       int load_avg;
       timer_sleep (sleep_until - timer_ticks ());
       load_avg = thread_get_load_avg ();
@@ -143,9 +143,9 @@ test_mlfqs_load_60 (void)
 static void
 load_thread (void *aux UNUSED) 
 {
-  int64_t sleep_time = 10 * TIMER_FREQ;
-  int64_t spin_time = sleep_time + 60 * TIMER_FREQ;
-  int64_t exit_time = spin_time + 60 * TIMER_FREQ;
+  int64_t sleep_time = 10 * timer_freq;
+  int64_t spin_time = sleep_time + 60 * timer_freq;
+  int64_t exit_time = spin_time + 60 * timer_freq;
 
   thread_set_nice (20);
   timer_sleep (sleep_time - timer_elapsed (start_time));
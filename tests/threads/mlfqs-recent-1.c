@@ -104,7 +104,7 @@
 #include "devices/timer.h"
 
 /* Sensitive to assumption that recent_cpu updates happen exactly
-   when timer_ticks() % TIMER_FREQ == 0. */
+   when timer_ticks() % timer_freq == 0. */
 
 void
 test_mlfqs_recent_1 (void) 
@@ -118,8 +118,8 @@ test_mlfqs_recent_1 (void)
     {
       msg ("Sleeping 10 seconds to allow recent_cpu to decay, please wait...");
       start_time = timer_ticks ();
-      timer_sleep (DIV_ROUND_UP (start_time, TIMER_FREQ) - start_time
-                   + 10 * TIMER_FREQ);
+      timer_sleep (DIV_ROUND_UP (start_time, timer_freq) - start_time
+                   + 10 * timer_freq);
     }
   while (thread_get_recent_cpu () > 700);
 
@@ -127,11 +127,11 @@ test_mlfqs_recent_1 (void)
   for (;;) 
     {
       int elapsed = timer_elapsed (start_time);
-      if (elapsed % (TIMER_FREQ * 2) == 0 && elapsed > last_elapsed) 
+      if (elapsed % (timer_freq * 2) == 0 && elapsed > last_elapsed) 
         {
           int recent_cpu = thread_get_recent_cpu ();
           int load_avg = thread_get_load_avg ();
-          int elapsed_seconds = elapsed / TIMER_FREQ;
+          int elapsed_seconds = elapsed / timer_freq;
           msg ("After %d seconds, recent_cpu is %d.%02d, load_avg is %d.%02d.",
                elapsed_seconds,
                recent_cpu / 100, recent_cpu % 100,
@@ -0,0 +1,120 @@
+/* Builds a chain of priority donations much deeper than the 8
+   levels of priority-donate-chain and checks that the top
+   priority reaches the bottom of it.
+
+   The main thread sets its priority to PRI_MIN, acquires lock 0,
+   and creates threads 1 through DEPTH with priorities PRI_MIN + 1
+   through PRI_MIN + DEPTH.  Thread i acquires lock i (unless i
+   == DEPTH) and then blocks on lock i - 1, donating its priority
+   down the chain, so after thread i is created the main thread
+   should have priority PRI_MIN + i.
+
+   When the main thread releases lock 0, each thread in turn
+   should run with priority PRI_MIN + DEPTH, since thread DEPTH is
+   still waiting at the top of the chain, and the threads should
+   finish from the top down.  Each thread also times its release
+   of lock i - 1, which it holds along with lock i. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define DEPTH 40
+
+struct link
+  {
+    struct lock *first;         /* Lock to acquire first, or null. */
+    struct lock *second;        /* Lock to block on. */
+    int number;                 /* Position in chain, 1...DEPTH. */
+  };
+
+static thread_func chain_thread_func;
+
+static struct lock locks[DEPTH];
+static struct link links[DEPTH + 1];
+static struct semaphore done;
+static int finish_order[DEPTH];
+static int finish_cnt;
+static int wrong_priority;
+static uint64_t max_release;
+
+void
+test_priority_donate_deep (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (PRI_MIN + DEPTH <= PRI_MAX);
+
+  sema_init (&done, 0);
+  finish_cnt = 0;
+  wrong_priority = 0;
+  max_release = 0;
+
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < DEPTH; i++)
+    lock_init (&locks[i], "chain");
+  lock_acquire (&locks[0]);
+
+  for (i = 1; i <= DEPTH; i++)
+    {
+      char name[16];
+
+      links[i].first = i < DEPTH ? &locks[i] : NULL;
+      links[i].second = &locks[i - 1];
+      links[i].number = i;
+      snprintf (name, sizeof name, "chain %d", i);
+      thread_create (name, PRI_MIN + i, chain_thread_func, &links[i]);
+      if (thread_get_priority () != PRI_MIN + i)
+        fail ("main should have priority %d but has %d.",
+              PRI_MIN + i, thread_get_priority ());
+    }
+  msg ("Chain of %d threads donated priority %d to main.",
+       DEPTH, thread_get_priority ());
+
+  lock_release (&locks[0]);
+  for (i = 0; i < DEPTH; i++)
+    sema_down (&done);
+
+  if (thread_get_priority () != PRI_MIN)
+    fail ("main should have priority %d after release but has %d.",
+          PRI_MIN, thread_get_priority ());
+  if (wrong_priority != 0)
+    fail ("chain thread %d ran without the top priority.", wrong_priority);
+  for (i = 0; i < DEPTH; i++)
+    if (finish_order[i] != DEPTH - i)
+      fail ("chain thread %d finished in position %d.", finish_order[i], i);
+  msg ("Longest release took %"PRIu64" cycles.", max_release);
+  pass ();
+}
+
+static void
+chain_thread_func (void *link_)
+{
+  struct link *link = link_;
+  uint64_t start, end;
+
+  if (link->first != NULL)
+    lock_acquire (link->first);
+  lock_acquire (link->second);
+
+  if (link->number < DEPTH && thread_get_priority () != PRI_MIN + DEPTH)
+    wrong_priority = link->number;
+
+  start = rdtsc ();
+  lock_release (link->second);
+  end = rdtsc ();
+  if (end - start > max_release)
+    max_release = end - start;
+
+  if (link->first != NULL)
+    lock_release (link->first);
+
+  finish_order[finish_cnt++] = link->number;
+  sema_up (&done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing donation result in output"
+  unless grep ($_ eq '(priority-donate-deep) Chain of 40 threads donated priority 40 to main.',
+	       @output);
+fail "missing release time in output"
+  unless grep (/^\(priority-donate-deep\) Longest release took \d+ cycles\.$/,
+	       @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(priority-donate-deep) PASS', @output);
+
+pass;
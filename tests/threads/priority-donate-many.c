@@ -0,0 +1,121 @@
+/* Has many more threads donate to a single lock than the 8
+   donors that priority donation used to be limited to, and
+   checks that the lock's holder receives the highest donation
+   and that the donors acquire the lock in priority order.
+
+   The main thread acquires a lock and creates DONOR_CNT donors,
+   two at each priority from PRI_MIN + 1 to PRI_MIN + 60, in a
+   scrambled order.  It then drops its own priority to PRI_MIN
+   and sleeps until every donor is blocked on the lock, at which
+   point it should have the top donor's priority.
+
+   When the main thread releases the lock, the donors should get
+   it from the highest priority down, and the two donors at each
+   priority in the order they were created.  Each donor times its
+   own release, which hands the lock to the next donor while up
+   to DONOR_CNT - 2 others are still waiting, and the main thread
+   reports the average and longest release. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define DONOR_CNT 120
+#define PRI_CNT 60
+
+struct donor
+  {
+    int number;                 /* Order of creation. */
+    int priority;               /* Priority. */
+  };
+
+static thread_func donor_thread_func;
+
+static struct lock lock;
+static struct semaphore done;
+static struct donor donors[DONOR_CNT];
+static struct donor *acquire_order[DONOR_CNT];
+static int acquire_cnt;
+static uint64_t total_release;
+static uint64_t max_release;
+
+void
+test_priority_donate_many (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (PRI_MIN + PRI_CNT < PRI_MAX);
+
+  lock_init (&lock, "lock");
+  sema_init (&done, 0);
+  acquire_cnt = 0;
+  total_release = max_release = 0;
+
+  thread_set_priority (PRI_MAX);
+  lock_acquire (&lock);
+  for (i = 0; i < DONOR_CNT; i++)
+    {
+      struct donor *d = &donors[i];
+      char name[16];
+
+      d->number = i;
+      d->priority = PRI_MIN + 1 + i * 37 % PRI_CNT;
+      snprintf (name, sizeof name, "donor %d", i);
+      thread_create (name, d->priority, donor_thread_func, d);
+    }
+
+  thread_set_priority (PRI_MIN);
+  while (heap_size (&lock.semaphore.waiters) < DONOR_CNT)
+    timer_sleep (1);
+  if (thread_get_priority () != PRI_MIN + PRI_CNT)
+    fail ("main should have priority %d but has %d.",
+          PRI_MIN + PRI_CNT, thread_get_priority ());
+  msg ("%d donors donated priority %d to main.",
+       DONOR_CNT, thread_get_priority ());
+
+  lock_release (&lock);
+  for (i = 0; i < DONOR_CNT; i++)
+    sema_down (&done);
+
+  for (i = 1; i < DONOR_CNT; i++)
+    {
+      struct donor *a = acquire_order[i - 1];
+      struct donor *b = acquire_order[i];
+
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->number > b->number))
+        fail ("donor %d (priority %d) acquired the lock before "
+              "donor %d (priority %d).",
+              a->number, a->priority, b->number, b->priority);
+    }
+  msg ("Average release took %"PRIu64" cycles.",
+       total_release / DONOR_CNT);
+  msg ("Longest release took %"PRIu64" cycles.", max_release);
+  pass ();
+}
+
+static void
+donor_thread_func (void *donor_)
+{
+  struct donor *d = donor_;
+  uint64_t start, end;
+
+  lock_acquire (&lock);
+  acquire_order[acquire_cnt++] = d;
+
+  start = rdtsc ();
+  lock_release (&lock);
+  end = rdtsc ();
+  total_release += end - start;
+  if (end - start > max_release)
+    max_release = end - start;
+
+  sema_up (&done);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing donation result in output"
+  unless grep ($_ eq '(priority-donate-many) 120 donors donated priority 60 to main.',
+	       @output);
+foreach my $what ('Average', 'Longest') {
+    fail "missing \L$what\E release time in output"
+      unless grep (/^\(priority-donate-many\) $what release took \d+ cycles\.$/,
+		   @output);
+}
+fail "missing PASS in output"
+  unless grep ($_ eq '(priority-donate-many) PASS', @output);
+
+pass;
@@ -0,0 +1,73 @@
+/* Tests that a readers-writer lock lets readers share it, that
+   a waiting writer keeps new readers out, and that when the lock
+   is released the waiting writers get it one at a time from the
+   highest priority down, before any waiting reader, and then
+   the waiting readers get it together. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+static struct rwlock rwlock;
+
+void
+test_priority_rwlock (void) 
+{
+  int i;
+  
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock, "rwlock");
+  thread_set_priority (PRI_MIN);
+
+  rwlock_acquire_read (&rwlock);
+  if (rwlock_try_acquire_read (&rwlock))
+    {
+      msg ("Second reader got lock.");
+      rwlock_release_read (&rwlock);
+    }
+  thread_create ("writer 31", PRI_DEFAULT, writer_thread, NULL);
+  msg ("Reader behind waiting writer %s.",
+       rwlock_try_acquire_read (&rwlock) ? "got lock" : "blocked");
+  rwlock_release_read (&rwlock);
+  msg ("Back in main thread.");
+
+  rwlock_acquire_write (&rwlock);
+  for (i = 0; i < 5; i++) 
+    {
+      int priority = PRI_DEFAULT + 1 + i * 2 % 5;
+      char name[16];
+      snprintf (name, sizeof name, "writer %d", priority);
+      thread_create (name, priority, writer_thread, NULL);
+    }
+  for (i = 0; i < 5; i++) 
+    {
+      int priority = PRI_DEFAULT + 6 + i * 2 % 5;
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", priority);
+      thread_create (name, priority, reader_thread, NULL);
+    }
+  rwlock_release_write (&rwlock);
+  msg ("Back in main thread.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("Thread %s got lock.", thread_name ());
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("Thread %s got lock.", thread_name ());
+  rwlock_release_write (&rwlock);
+}
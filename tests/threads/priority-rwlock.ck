@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock) begin
+(priority-rwlock) Second reader got lock.
+(priority-rwlock) Reader behind waiting writer blocked.
+(priority-rwlock) Thread writer 31 got lock.
+(priority-rwlock) Back in main thread.
+(priority-rwlock) Thread writer 36 got lock.
+(priority-rwlock) Thread writer 35 got lock.
+(priority-rwlock) Thread writer 34 got lock.
+(priority-rwlock) Thread writer 33 got lock.
+(priority-rwlock) Thread writer 32 got lock.
+(priority-rwlock) Thread reader 41 got lock.
+(priority-rwlock) Thread reader 40 got lock.
+(priority-rwlock) Thread reader 39 got lock.
+(priority-rwlock) Thread reader 38 got lock.
+(priority-rwlock) Thread reader 37 got lock.
+(priority-rwlock) Back in main thread.
+(priority-rwlock) end
+EOF
+pass;
@@ -0,0 +1,119 @@
+/* Measures the cost of a trip through the run queue as the
+   number of runnable threads grows from 10 to 500.
+
+   The main thread keeps a pool of worker threads, all at
+   PRI_DEFAULT.  For each thread count N, it wakes N workers and
+   drops its own priority to PRI_MIN, so that the workers run.
+   Each worker yields YIELD_CNT times, which enqueues it at the
+   tail of its priority's run queue and dequeues the next worker,
+   and then blocks again.  Once every worker is blocked, the main
+   thread runs again and reports the average number of TSC cycles
+   per yield.
+
+   With a constant-time run queue the cost per yield should not
+   depend on N; the test fails if it grows by more than a factor
+   of MAX_GROWTH between the smallest and the largest N. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define MAX_THREAD_CNT 500
+#define YIELD_CNT 16
+#define MAX_GROWTH 4
+
+struct worker
+  {
+    struct semaphore go;        /* Upped to start a round. */
+  };
+
+static const int thread_cnts[] = {10, 50, 100, 250, MAX_THREAD_CNT};
+#define ROUND_CNT ((int) (sizeof thread_cnts / sizeof *thread_cnts))
+
+static bool stop;
+static thread_func worker_func;
+
+void
+test_sched_bench (void)
+{
+  struct worker *workers;
+  uint64_t per_yield[ROUND_CNT];
+  int created = 0;
+  int round;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  workers = malloc (sizeof *workers * MAX_THREAD_CNT);
+  ASSERT (workers != NULL);
+  stop = false;
+
+  thread_set_priority (PRI_DEFAULT + 1);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      int thread_cnt = thread_cnts[round];
+      uint64_t start, end;
+
+      /* Create any workers this round needs and let them reach
+         their semaphores, so that thread startup is not timed. */
+      for (; created < thread_cnt; created++)
+        {
+          char name[16];
+
+          sema_init (&workers[created].go, 0);
+          snprintf (name, sizeof name, "worker %d", created);
+          if (thread_create (name, PRI_DEFAULT, worker_func,
+                             &workers[created]) == TID_ERROR)
+            fail ("could not create worker %d", created);
+        }
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_DEFAULT + 1);
+
+      /* Run the round. */
+      for (i = 0; i < thread_cnt; i++)
+        sema_up (&workers[i].go);
+      start = rdtsc ();
+      thread_set_priority (PRI_MIN);
+      end = rdtsc ();
+      thread_set_priority (PRI_DEFAULT + 1);
+
+      per_yield[round] = (end - start) / ((uint64_t) thread_cnt * YIELD_CNT);
+      msg ("%d threads: %"PRIu64" cycles per yield.",
+           thread_cnt, per_yield[round]);
+    }
+
+  /* Let the workers exit. */
+  stop = true;
+  for (i = 0; i < created; i++)
+    sema_up (&workers[i].go);
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+  free (workers);
+
+  if (per_yield[ROUND_CNT - 1] > per_yield[0] * MAX_GROWTH)
+    fail ("cost per yield grew from %"PRIu64" to %"PRIu64" cycles",
+          per_yield[0], per_yield[ROUND_CNT - 1]);
+  pass ();
+}
+
+static void
+worker_func (void *worker_)
+{
+  struct worker *w = worker_;
+  int i;
+
+  for (;;)
+    {
+      sema_down (&w->go);
+      if (stop)
+        break;
+      for (i = 0; i < YIELD_CNT; i++)
+        thread_yield ();
+    }
+}
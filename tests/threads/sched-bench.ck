@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $thread_cnt (10, 50, 100, 250, 500) {
+    fail "missing result for $thread_cnt threads in output"
+      unless grep (/^\(sched-bench\) $thread_cnt threads: \d+ cycles per yield\.$/,
+		   @output);
+}
+fail "missing PASS in output"
+  unless grep ($_ eq '(sched-bench) PASS', @output);
+
+pass;
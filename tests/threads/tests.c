@@ -13,10 +13,13 @@ static const struct test tests[] =
   {
     {"alarm-single", test_alarm_single},
     {"alarm-multiple", test_alarm_multiple},
+    {"alarm-multiple-smp", test_alarm_multiple_smp},
+    {"alarm-multiple-nohz", test_alarm_multiple_nohz},
     {"alarm-simultaneous", test_alarm_simultaneous},
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-usleep", test_alarm_usleep},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +28,9 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
+    {"priority-donate-many", test_priority_donate_many},
+    {"priority-rwlock", test_priority_rwlock},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +44,14 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"sched-bench", test_sched_bench},
+    {"cfs-fair-3", test_cfs_fair_3},
+    {"cfs-nice-3", test_cfs_nice_3},
+    {"cfs-group-4", test_cfs_group_4},
+    {"cfs-group-quota", test_cfs_group_quota},
+    {"workqueue", test_workqueue},
+    {"edf-deadline", test_edf_deadline},
+    {"edf-admit", test_edf_admit},
   };
 
 static const char *test_name;
@@ -0,0 +1,72 @@
+/* Checks that softirqs and worker threads hand work along as
+   intended.
+
+   A timeout, which fires in the timer softirq, queues a work
+   item, and queueing it a second time before it runs must have
+   no effect.  The work item must then run exactly once, outside
+   interrupt context, in a worker thread, where it is allowed to
+   sleep. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timeout.h"
+#include "devices/timer.h"
+
+static timeout_func queue_work;
+static work_func do_work;
+
+static struct work work;
+static struct semaphore done;
+static volatile int run_cnt;
+static volatile bool queued_in_intr, queued_twice;
+
+void
+test_workqueue (void)
+{
+  struct timeout timeout;
+
+  sema_init (&done, 0);
+  work_init (&work, do_work, NULL);
+  timeout_init (&timeout, queue_work, NULL);
+  timeout_add (&timeout, timer_ticks () + 1);
+
+  sema_down (&done);
+  if (!queued_in_intr)
+    fail ("timeout did not run in interrupt context.");
+  if (queued_twice)
+    fail ("work item was queued twice.");
+  msg ("work queued from the timer softirq.");
+
+  /* Give a second run, if there were one, time to happen. */
+  timer_sleep (4);
+  if (run_cnt != 1)
+    fail ("work item ran %d times.", run_cnt);
+  msg ("work ran once.");
+  pass ();
+}
+
+static void
+queue_work (void *aux UNUSED)
+{
+  queued_in_intr = intr_context ();
+  work_queue (&work);
+  queued_twice = work_queue (&work);
+}
+
+static void
+do_work (void *aux UNUSED)
+{
+  if (intr_context ())
+    fail ("work item ran in interrupt context.");
+  if (memcmp (thread_name (), "kworker", 7))
+    fail ("work item ran in thread \"%s\".", thread_name ());
+  timer_sleep (1);
+  run_cnt++;
+  sema_up (&done);
+}
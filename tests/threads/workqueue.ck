@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) work queued from the timer softirq.
+(workqueue) work ran once.
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Child process run by the schedgroup test.
+   Tries to configure and to join the scheduling group given as
+   the first command-line argument, which its parent created,
+   verifying that both are refused. */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-schedgroup";
+
+int
+main (int argc UNUSED, char *argv[]) 
+{
+  struct schedgroup_params params = {SCHEDGROUP_WEIGHT_MIN, 1, 100};
+  int group;
+
+  if (!isdigit (*argv[1]))
+    fail ("bad command-line arguments");
+  group = atoi (argv[1]);
+
+  CHECK (!schedgroup_set (group, &params), "schedgroup_set(parent's group)");
+  CHECK (!schedgroup_join (group), "schedgroup_join(parent's group)");
+  return 0;
+}
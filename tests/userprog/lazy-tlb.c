@@ -0,0 +1,40 @@
+/* Ping-pongs between this process and a kernel thread, and
+   checks that the switches rarely load a page directory.
+
+   Each read from "sample.txt" waits for the disk, so the idle
+   thread runs until the disk interrupts and this process runs
+   again.  The idle thread borrows this process's page directory
+   instead of loading the kernel-only one, so this process finds
+   its own still loaded when it returns.  The total number of
+   loads avoided is printed when Pintos powers off. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 200
+
+void
+test_main (void)
+{
+  struct schedstat before, after;
+  char buf[512];
+  int64_t runs, loads;
+  int handle, i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (schedstat (0, &before), "schedstat(0)");
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      seek (handle, 0);
+      if (read (handle, buf, sizeof buf) <= 0)
+        fail ("read \"sample.txt\" failed");
+    }
+  CHECK (schedstat (0, &after), "schedstat(0)");
+
+  runs = after.run_cnt - before.run_cnt;
+  loads = after.pd_load_cnt - before.pd_load_cnt;
+  if (loads * 2 > runs)
+    fail ("%lld page directory loads in %lld switches", loads, runs);
+  msg ("page directory loads avoided");
+}
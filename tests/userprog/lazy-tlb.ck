@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lazy-tlb) begin
+(lazy-tlb) open "sample.txt"
+(lazy-tlb) schedstat(0)
+(lazy-tlb) schedstat(0)
+(lazy-tlb) page directory loads avoided
+(lazy-tlb) end
+lazy-tlb: exit(0)
+EOF
+pass;
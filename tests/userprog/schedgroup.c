@@ -0,0 +1,50 @@
+/* Checks the scheduling group system calls.  The process creates
+   a group, which it may configure but the root group may not,
+   and which a child process may neither configure nor join.
+   Then it joins the group.  With a quota of 1 tick in every 10, it must then
+   be parked each time it uses up the quota, which schedstat()
+   counts as blocking. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int64_t
+ticks (const struct schedstat *st)
+{
+  return st->user_ticks + st->kernel_ticks;
+}
+
+void
+test_main (void)
+{
+  struct schedgroup_params params = {SCHEDGROUP_WEIGHT_DEFAULT, 1, 10};
+  struct schedstat before, after;
+  char cmd[32];
+  int group;
+
+  group = schedgroup_create ();
+  CHECK (group > 0, "schedgroup_create()");
+  CHECK (!schedgroup_join (group + 1), "schedgroup_join(bad group)");
+  CHECK (!schedgroup_set (0, &params), "schedgroup_set(root group)");
+  params.weight = 0;
+  CHECK (!schedgroup_set (group, &params), "schedgroup_set(weight 0)");
+  params.weight = SCHEDGROUP_WEIGHT_DEFAULT;
+  CHECK (schedgroup_set (group, &params), "schedgroup_set(1 tick per 10)");
+  snprintf (cmd, sizeof cmd, "child-schedgroup %d", group);
+  CHECK (wait (exec (cmd)) == 0, "exec child-schedgroup");
+  CHECK (schedgroup_join (group), "schedgroup_join(group)");
+
+  /* Spin for 5 ticks of CPU time. */
+  CHECK (schedstat (0, &before), "schedstat(0)");
+  do
+    schedstat (0, &after);
+  while (ticks (&after) - ticks (&before) < 5);
+  if (after.voluntary_cnt - before.voluntary_cnt < 3)
+    fail ("parked only %lld times",
+          after.voluntary_cnt - before.voluntary_cnt);
+  msg ("parked while throttled");
+
+  CHECK (schedgroup_join (0), "schedgroup_join(root group)");
+}
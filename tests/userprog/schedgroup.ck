@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedgroup) begin
+(schedgroup) schedgroup_create()
+(schedgroup) schedgroup_join(bad group)
+(schedgroup) schedgroup_set(root group)
+(schedgroup) schedgroup_set(weight 0)
+(schedgroup) schedgroup_set(1 tick per 10)
+(schedgroup) exec child-schedgroup
+(child-schedgroup) schedgroup_set(parent's group)
+(child-schedgroup) schedgroup_join(parent's group)
+child-schedgroup: exit(0)
+(schedgroup) schedgroup_join(group)
+(schedgroup) schedstat(0)
+(schedgroup) parked while throttled
+(schedgroup) schedgroup_join(root group)
+(schedgroup) end
+schedgroup: exit(0)
+EOF
+pass;
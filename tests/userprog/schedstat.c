@@ -0,0 +1,35 @@
+/* Checks the scheduling statistics returned by schedstat().
+   Waiting for a child process must count as blocking, and the
+   statistics of a process that has exited, or never existed,
+   must not be available. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct schedstat before, after;
+  pid_t child;
+
+  CHECK (schedstat (0, &before), "schedstat(0)");
+  if (before.run_cnt < 1)
+    fail ("run_cnt is %lld", before.run_cnt);
+
+  child = exec ("child-simple");
+  msg ("wait(exec()) = %d", wait (child));
+
+  CHECK (schedstat (0, &after), "schedstat(0)");
+  if (after.voluntary_cnt <= before.voluntary_cnt)
+    fail ("waiting for a child did not block");
+  if (after.run_cnt <= before.run_cnt)
+    fail ("running again after wait() was not counted");
+  if (after.wait_max_ns > after.wait_ns
+      || after.wakeup_max_ns > after.wakeup_ns
+      || after.wakeup_ns > after.wait_ns)
+    fail ("inconsistent wait times");
+
+  CHECK (!schedstat (child, &after), "schedstat(child) after exit");
+  CHECK (!schedstat (-1, &after), "schedstat(-1)");
+}
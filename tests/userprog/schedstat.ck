@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstat) begin
+(schedstat) schedstat(0)
+(child-simple) run
+child-simple: exit(81)
+(schedstat) wait(exec()) = 81
+(schedstat) schedstat(0)
+(schedstat) schedstat(child) after exit
+(schedstat) schedstat(-1)
+(schedstat) end
+schedstat: exit(0)
+EOF
+pass;
@@ -0,0 +1,209 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/tss.h"
+#endif
+
+/* Symmetric multiprocessing.
+
+   By default Pintos runs on the bootstrap processor (BSP) alone.
+   With the kernel command-line option "-smp=N", main() calls
+   cpu_start_aps() to start up to N - 1 application processors
+   (APs) as well.  Each AP runs threads from its own run queue
+   and steals threads from the other CPUs when it runs out.
+
+   Only the BSP receives device interrupts.  Each CPU, though,
+   ticks from its own local APIC timer (see timer_init_ap()), so
+   every CPU preempts its running thread for its time slice in
+   timer_interrupt() and account_tick().  With "-pit", or
+   without a local APIC, the PIT ticks on the BSP alone, and the
+   APs switch threads only when the running thread blocks or
+   yields.  Idle CPUs are woken up by reschedule IPIs. */
+
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* Arguments that ap-start.S reads, in the copy of it that the APs
+   run.  Must match ap_start_args in ap-start.S. */
+struct ap_start_args
+  {
+    uint32_t cr3;                       /* Physical address of page directory. */
+    void (*entry) (int);                /* C entry point. */
+    void **stacks;                      /* Initial stack pointers. */
+    uint32_t cnt;                       /* Number of stacks. */
+    volatile uint32_t next;             /* Next stack to claim. */
+  };
+
+/* Start code for the APs, in ap-start.S. */
+extern const char ap_start[], ap_start_args[], ap_start_end[];
+
+/* Initial stack pointers of the APs, at the tops of their idle
+   threads' pages.  Stack I belongs to cpus[I + 1]. */
+static void *ap_stacks[CPU_MAX - 1];
+
+static void ap_main (int idx) NO_RETURN;
+static int count_online (void);
+static intr_handler_func resched_interrupt;
+
+/* Returns the CPU that is running the caller.  Unless interrupts
+   are off, the running thread may move to another CPU at any
+   time, making the result stale. */
+struct cpu *
+cpu_current (void)
+{
+  uint32_t *esp;
+
+  if (cpu_cnt == 1)
+    return &cpus[0];
+
+  /* The running thread knows its CPU.  Find the running thread
+     the same way as thread.c's running_thread(), without its
+     sanity checks, which in turn use intr_context(). */
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->cpu;
+}
+
+/* Starts the application processors, so that CNT CPUs in all
+   run threads, or fewer if the machine has fewer CPUs.  Must be
+   called by the BSP, with interrupts on and the timer
+   calibrated, before any process is started. */
+void
+cpu_start_aps (int cnt)
+{
+  struct ap_start_args *args;
+  uint32_t *pd;
+  int i;
+
+  ASSERT (cpu_cnt == 1);
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (cnt > CPU_MAX)
+    cnt = CPU_MAX;
+  if (cnt <= 1)
+    return;
+  if (!lapic_enabled () && !lapic_init ())
+    {
+      printf ("No local APIC, using 1 CPU.\n");
+      return;
+    }
+  cpus[0].apic_id = lapic_id ();
+  intr_register_ext (LAPIC_VEC_RESCHED, resched_interrupt,
+                     "Reschedule IPI");
+
+  /* Set up each AP's idle thread, on whose stack it will start,
+     and the rest of its per-CPU state. */
+  for (i = 1; i < cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      struct thread *t;
+
+      c->id = i;
+      t = thread_prepare_ap (c);
+      if (t == NULL)
+        break;
+#ifdef USERPROG
+      tss_init_ap (c);
+#endif
+      trace_init_ap (c);
+      ap_stacks[i - 1] = (uint8_t *) t + PGSIZE;
+    }
+  cnt = i;
+
+  /* The APs start out with paging off, so they need a page
+     directory that also maps the start code at its physical
+     address.  Map the first 4 MB of physical memory at virtual
+     address 0, in addition to the kernel mappings.  An AP that is
+     slow to start may use it at any time, so it is never freed. */
+  pd = palloc_get_page (PAL_ASSERT);
+  memcpy (pd, init_page_dir, PGSIZE);
+  pd[0] = init_page_dir[pd_no (ptov (0))];
+
+  ASSERT (ap_start_end - ap_start <= LOADER_BASE - AP_START_PADDR);
+  memcpy (ptov (AP_START_PADDR), ap_start, ap_start_end - ap_start);
+  args = ptov (AP_START_PADDR + (ap_start_args - ap_start));
+  args->cr3 = vtop (pd);
+  args->entry = ap_main;
+  args->stacks = ap_stacks;
+  args->cnt = cnt - 1;
+  args->next = 0;
+
+  /* From now on cpu_current() has to ask the running thread. */
+  cpu_cnt = cnt;
+  lapic_start_aps (AP_START_PADDR);
+
+  /* Give the APs up to a second to come up. */
+  for (i = 0; i < 100 && count_online () < cnt; i++)
+    timer_msleep (10);
+  printf ("%d of %d CPUs online.\n", count_online (), cnt);
+}
+
+/* Makes CPU C reschedule soon, for example to steal a thread
+   that has become ready while it was idle.  Interrupts must be
+   off. */
+void
+cpu_kick (struct cpu *c)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (c != cpu_current () && c->online)
+    lapic_send_ipi (c->apic_id, LAPIC_VEC_RESCHED);
+}
+
+/* C entry point for application processors, called by
+   ap-start.S on the stack of the idle thread for cpus[IDX + 1],
+   with interrupts off and paging on. */
+static void
+ap_main (int idx)
+{
+  struct cpu *c = &cpus[idx + 1];
+
+  /* Leave the start-up page directory. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+
+  intr_init_ap ();
+#ifdef USERPROG
+  gdt_init_ap (c);
+#endif
+  lapic_init_ap ();
+  c->apic_id = lapic_id ();
+  timer_init_ap ();
+
+  thread_start_ap ();
+}
+
+/* Returns the number of CPUs that are running threads. */
+static int
+count_online (void)
+{
+  int i, cnt = 0;
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (cpus[i].online)
+      cnt++;
+  return cnt;
+}
+
+/* Reschedule IPI handler. */
+static void
+resched_interrupt (struct intr_frame *f UNUSED)
+{
+#ifdef USERPROG
+  /* pagedir_destroy() may be waiting for us to stop borrowing a
+     page directory. */
+  pagedir_unlazy ();
+#endif
+  intr_yield_on_return ();
+}
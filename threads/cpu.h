@@ -0,0 +1,126 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 8
+
+/* Run queue of threads in THREAD_READY state, that is, threads
+   that are ready to run but not actually running.
+
+   Under the priority scheduler and the MLFQS, there is one FIFO
+   list per priority level, and bit P of `bitmap' is set if and
+   only if queues[P] is nonempty, so that both insertion and
+   picking the highest priority thread take constant time.
+
+   Under the completely fair scheduler, the threads are instead
+   kept in trees in order of virtual runtime, one per scheduling
+   group, and `tree' holds the groups that have threads here in
+   order of their own virtual runtimes (see threads/schedgroup.h),
+   so that insertion takes O(lg n) time and picking the group and
+   then the thread with the least virtual runtime takes constant
+   time.
+
+   Under every scheduler, EDF threads (see thread_create_edf())
+   are kept apart in `edf', ordered by deadline, and always run
+   before the threads in `queues' or `tree'. */
+struct runqueue
+  {
+    struct spinlock lock;               /* Protects the members below. */
+    struct list queues[PRI_MAX + 1];    /* One list per priority. */
+    uint64_t bitmap;                    /* Nonempty queues. */
+    struct rbtree tree;                 /* Groups by virtual runtime. */
+    int64_t min_vruntime;               /* Floor of groups' runtimes. */
+    unsigned long load;                 /* Sum of weights of threads in trees. */
+    struct heap edf;                    /* EDF threads by deadline. */
+    size_t cnt;                         /* # of threads in queues, trees, edf. */
+  };
+
+/* Per-CPU state.
+
+   Each CPU schedules threads from its own run queue, and steals
+   threads from the other CPUs' run queues when it runs out.
+
+   The members owned by thread.c and interrupt.c may only be used
+   by the CPU itself, with interrupts off, except that other CPUs
+   may read `curr', `online', and `active_pd' and may take
+   `rq.lock'. */
+struct cpu
+  {
+    int id;                             /* Index in cpus[]. */
+    uint8_t apic_id;                    /* Local APIC ID. */
+    bool online;                        /* Running and scheduling? */
+
+    /* Owned by thread.c. */
+    struct thread *idle_thread;         /* Runs when nothing else can. */
+    struct thread *curr;                /* Thread running on this CPU. */
+    struct runqueue rq;                 /* Threads ready to run here. */
+    unsigned thread_ticks;              /* # of timer ticks since last yield. */
+    long long idle_ticks;               /* # of timer ticks spent idle. */
+    long long kernel_ticks;             /* # of timer ticks in kernel mode. */
+    long long user_ticks;               /* # of timer ticks in user mode. */
+
+    /* Owned by interrupt.c. */
+    bool in_external_intr;              /* Processing an external interrupt? */
+    bool yield_on_return;               /* Yield on interrupt return? */
+
+    /* Owned by threads/softirq.c. */
+    uint32_t softirq_pending;           /* Bit per pending softirq type. */
+    bool in_softirq;                    /* Running softirqs? */
+
+    /* Owned by threads/palloc.c. */
+    struct palloc_mag mags[2];          /* Kernel and user pool pages. */
+    long long mag_hits;                 /* # of pages got from mags. */
+    long long mag_misses;               /* # of refills of empty mags. */
+    long long zero_hits;                /* # of PAL_ZERO pages found zeroed. */
+    long long zero_misses;              /* # of PAL_ZERO pages zeroed here. */
+    long long zero_idle;                /* # of pages zeroed while idle. */
+
+    /* Owned by threads/trace.c. */
+    struct trace_event *trace_buf;      /* Ring of trace events, or null. */
+    uint32_t trace_head;                /* Number of events recorded. */
+
+#ifdef USERPROG
+    /* Owned by userprog/tss.c. */
+    struct tss *tss;                    /* Task-state segment. */
+
+    /* Owned by userprog/pagedir.c. */
+    uint32_t *active_pd;                /* Page directory in CR3, or null. */
+
+    /* Owned by userprog/process.c. */
+    long long pd_loads;                 /* # of page directory loads. */
+    long long pd_skips;                 /* # of loads avoided. */
+#endif
+  };
+
+/* All CPUs.  cpus[0] is the bootstrap processor (BSP), which
+   runs init.c:main(); the others are application processors
+   (APs). */
+extern struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs in cpus[] that have been set up.  This is 1
+   unless the kernel was started with "-smp=N". */
+extern int cpu_cnt;
+
+struct cpu *cpu_current (void);
+void cpu_start_aps (int cnt);
+void cpu_kick (struct cpu *);
+
+/* Returns the current CPU's time-stamp counter, which counts
+   clock cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/cpu.h */
@@ -15,11 +15,15 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -54,6 +58,9 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
+/* -smp: Number of CPUs to use. */
+static int smp_cpu_cnt = 1;
+
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
@@ -98,6 +105,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  profile_init ();
+  trace_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -119,6 +128,10 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  workqueue_init ();
+
+  /* Start the other CPUs. */
+  cpu_start_aps (smp_cpu_cnt);
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -256,6 +269,33 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-nohz"))
+        timer_nohz = true;
+      else if (!strcmp (name, "-hz"))
+        {
+          timer_freq = value != NULL ? atoi (value) : 0;
+          if (timer_freq < TIMER_FREQ_MIN || timer_freq > TIMER_FREQ_MAX)
+            PANIC ("-hz must be between %d and %d",
+                   TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+        }
+      else if (!strcmp (name, "-pit"))
+        timer_pit = true;
+      else if (!strcmp (name, "-profile"))
+        profile_enabled = true;
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
+      else if (!strcmp (name, "-schedstat"))
+        thread_schedstat = true;
+      else if (!strcmp (name, "-edf-bound"))
+        {
+          thread_edf_bound = value != NULL ? atoi (value) : 0;
+          if (thread_edf_bound < 1 || thread_edf_bound > 100)
+            PANIC ("-edf-bound must be between 1 and 100");
+        }
+      else if (!strcmp (name, "-smp"))
+        smp_cpu_cnt = value != NULL ? atoi (value) : CPU_MAX;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -263,6 +303,8 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("options -mlfqs and -cfs are mutually exclusive");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -379,6 +421,15 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler.\n"
+          "  -nohz              Stop the timer tick while the CPU is idle.\n"
+          "  -hz=N              Interrupt N times/s, 100 to 1000 (default: 100).\n"
+          "  -pit               Take the timer tick from the PIT, not the local APIC.\n"
+          "  -profile           Sample call stacks on each timer tick.\n"
+          "  -trace             Print the kernel event trace at shutdown.\n"
+          "  -schedstat         Print per-thread scheduling statistics at shutdown.\n"
+          "  -edf-bound=PCT     Admit EDF threads up to PCT%% CPU use (default: 90).\n"
+          "  -smp[=N]           Use up to N CPUs (default: all, at most 8).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
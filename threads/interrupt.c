@@ -3,11 +3,16 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/softirq.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/clock.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -43,9 +48,14 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.
+
+   Besides the devices attached to the PICs, which interrupt the
+   bootstrap processor only, each CPU's local APIC delivers
+   external interrupts on vectors LAPIC_VEC_MIN and up.
+
+   Whether a CPU is processing an external interrupt, and whether
+   it should yield on return, is kept per CPU in struct cpu. */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -55,10 +65,66 @@ static void pic_end_of_interrupt (int irq);
 static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
+static void load_idt (void);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
+
+static inline enum intr_level enable_from (void *site);
+static inline enum intr_level disable_from (void *site);
+
+#ifdef IRQSOFF
+/* Interrupts-off latency statistics.
+
+   Every time interrupts go from on to off, the CPU notes the
+   time-stamp counter and the code responsible, and when they
+   come back on it files the length of the section in a log2
+   histogram and, if it is among the IRQSOFF_TOP longest seen on
+   the CPU, in a table along with the code that turned
+   interrupts off and the code that turned them back on.
+
+   Interrupts also go off when an interrupt gate is taken, and
+   back on when the handler returns with `iret'; such a section
+   is charged to the interrupt's handler function.  The kernel
+   also enables interrupts without going through intr_enable():
+   the idle thread with `sti', and a new process with the `iret'
+   into user mode.  The idle thread reports its `sti' with
+   irqsoff_stop(); in other cases, the section is dropped when
+   the next interrupt arrives and shows that interrupts were on. */
+
+/* Number of longest sections kept per CPU. */
+#define IRQSOFF_TOP 10
+
+/* Number of histogram buckets.  Bucket I counts sections that
+   lasted at least 2**I cycles but less than 2**(I+1), except that
+   the last bucket also counts any longer ones. */
+#define IRQSOFF_BUCKETS 40
+
+/* An interrupts-off section. */
+struct irqsoff_section
+  {
+    uint64_t cycles;            /* Length in TSC cycles. */
+    void *off_site;             /* Code that turned interrupts off. */
+    void *on_site;              /* Code that turned them back on. */
+  };
+
+/* Per-CPU interrupts-off statistics. */
+struct irqsoff_stats
+  {
+    uint64_t start;             /* TSC when interrupts went off,
+                                   or 0 if not in a section. */
+    void *off_site;             /* Code that turned them off. */
+    uint64_t cnt;               /* Number of sections. */
+    uint64_t hist[IRQSOFF_BUCKETS];             /* Histogram. */
+    struct irqsoff_section top[IRQSOFF_TOP];    /* Longest first. */
+  };
+
+static struct irqsoff_stats irqsoff_stats[CPU_MAX];
+
+static void irqsoff_begin (void *site);
+static void irqsoff_end (void *site);
+#endif /* IRQSOFF */
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -80,15 +146,40 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *site = __builtin_return_address (0);
+
+  return level == INTR_ON ? enable_from (site) : disable_from (site);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable_from (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable_from (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the code at SITE and returns
+   the previous interrupt status. */
+static inline enum intr_level
+enable_from (void *site UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
-  ASSERT (!intr_context ());
+
+  /* External interrupt handlers must run with interrupts off.
+     Softirqs, which run in interrupt context, may turn them on. */
+  ASSERT (old_level == INTR_ON || !cpu_current ()->in_external_intr);
+
+#ifdef IRQSOFF
+  if (old_level == INTR_OFF)
+    irqsoff_end (site);
+#endif
 
   /* Enable interrupts by setting the interrupt flag.
 
@@ -99,9 +190,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of the code at SITE and returns
+   the previous interrupt status. */
+static inline enum intr_level
+disable_from (void *site UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,14 +202,18 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+#ifdef IRQSOFF
+  if (old_level == INTR_ON)
+    irqsoff_begin (site);
+#endif
+
   return old_level;
 }
-
+
 /* Initializes the interrupt system. */
 void
 intr_init (void)
 {
-  uint64_t idtr_operand;
   int i;
 
   /* Initialize interrupt controller. */
@@ -126,12 +222,7 @@ intr_init (void)
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
     idt[i] = make_intr_gate (intr_stubs[i], 0);
-
-  /* Load IDT register.
-     See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
-     Descriptor Table (IDT)". */
-  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
-  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  load_idt ();
 
   /* Initialize intr_names. */
   for (i = 0; i < INTR_CNT; i++)
@@ -157,6 +248,23 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Initializes the interrupt system on an application processor,
+   which shares the bootstrap processor's IDT. */
+void
+intr_init_ap (void)
+{
+  load_idt ();
+}
+
+/* Loads the IDT register.  See [IA32-v2a] "LIDT" and [IA32-v3a]
+   5.10 "Interrupt Descriptor Table (IDT)". */
+static void
+load_idt (void)
+{
+  uint64_t idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -181,7 +289,8 @@ void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT ((vec_no >= 0x20 && vec_no <= 0x2f)
+          || (vec_no >= LAPIC_VEC_MIN && vec_no < LAPIC_VEC_SPURIOUS));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,27 +311,38 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (vec_no < 0x20 || (vec_no > 0x2f && vec_no < LAPIC_VEC_MIN));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or
+   of a softirq, and false at all other times. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  enum intr_level old_level;
+  struct cpu *c;
+  bool in_intr;
+
+  /* Softirqs run with interrupts on, so we must check the CPU's
+     state either way.  Turning interrupts off keeps the thread
+     from moving to another CPU while we look at it. */
+  old_level = intr_disable ();
+  c = cpu_current ();
+  in_intr = c->in_external_intr || c->in_softirq;
+  intr_set_level (old_level);
+  return in_intr;
 }
 
-/* During processing of an external interrupt, directs the
-   interrupt handler to yield to a new process just before
-   returning from the interrupt.  May not be called at any other
-   time. */
+/* During processing of an external interrupt or a softirq,
+   directs the interrupt handler to yield to a new process just
+   before returning from the interrupt.  May not be called at any
+   other time. */
 void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -344,28 +464,57 @@ make_idtr_operand (uint16_t limit, void *base)
 void
 intr_handler (struct intr_frame *frame) 
 {
-  bool external;
+  bool pic, external;
   intr_handler_func *handler;
+  struct cpu *c = NULL;
+
+#ifdef IRQSOFF
+  /* Interrupts were on when this interrupt arrived, so any
+     section still open on this CPU ended at some unknown time.
+     If the gate turned interrupts off, a new one starts now. */
+  if (frame->eflags & FLAG_IF)
+    {
+      irqsoff_stats[cpu_current () - cpus].start = 0;
+      if (intr_get_level () == INTR_OFF)
+        irqsoff_begin ((void *) intr_handlers[frame->vec_no]);
+    }
+#endif
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
+     and they need to be acknowledged on the PIC or the local
+     APIC (see below).
      An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  pic = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  external = pic || (frame->vec_no >= LAPIC_VEC_MIN
+                     && frame->vec_no != LAPIC_VEC_SPURIOUS);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      c = cpu_current ();
+      ASSERT (!c->in_external_intr);
+      c->in_external_intr = true;
+
+      /* An interrupt that arrives while softirqs run leaves any
+         yield request to the softirq_run() that it interrupted. */
+      if (!c->in_softirq)
+        c->yield_on_return = false;
+
+      /* An interrupt that wakes the CPU from tickless idle first
+         catches up on the ticks that passed, so that the timer
+         softirq fires the timeouts that came due before this
+         interrupt returns. */
+      if (c->curr == c->idle_thread)
+        timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_VEC_SPURIOUS)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -380,12 +529,29 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
-
-      if (yield_on_return) 
-        thread_yield (); 
+      c->in_external_intr = false;
+      if (pic)
+        pic_end_of_interrupt (frame->vec_no);
+      else
+        lapic_eoi ();
+
+      /* Run deferred work with interrupts on, then yield if the
+         handler or the softirqs asked to.  If this interrupt
+         arrived while softirqs were running, the interrupted
+         softirq_run() picks up anything it raised. */
+      if (!c->in_softirq)
+        {
+          softirq_run ();
+          if (c->yield_on_return) 
+            thread_yield (); 
+        }
     }
+
+#ifdef IRQSOFF
+  /* Returning with `iret' turns interrupts back on. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    irqsoff_end ((void *) intr_handlers[frame->vec_no]);
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -436,3 +602,116 @@ intr_name (uint8_t vec)
 {
   return intr_names[vec];
 }
+
+#ifdef IRQSOFF
+/* Starts an interrupts-off section on the current CPU, which
+   the code at SITE just turned off. */
+static void
+irqsoff_begin (void *site)
+{
+  struct irqsoff_stats *st = &irqsoff_stats[cpu_current () - cpus];
+
+  st->off_site = site;
+  st->start = rdtsc ();
+}
+
+/* Ends the current CPU's interrupts-off section, if one is
+   open, as the code at SITE is about to turn interrupts on. */
+static void
+irqsoff_end (void *site)
+{
+  struct irqsoff_stats *st = &irqsoff_stats[cpu_current () - cpus];
+  uint64_t cycles;
+  uint32_t hi, lo;
+  int bucket, i;
+
+  if (st->start == 0)
+    return;
+  cycles = rdtsc () - st->start;
+  st->start = 0;
+
+  /* Bucket is floor(log2(cycles)). */
+  hi = cycles >> 32;
+  lo = cycles;
+  if (hi != 0)
+    bucket = 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    bucket = 31 - __builtin_clz (lo);
+  else
+    bucket = 0;
+  if (bucket >= IRQSOFF_BUCKETS)
+    bucket = IRQSOFF_BUCKETS - 1;
+  st->hist[bucket]++;
+  st->cnt++;
+
+  /* Insert into the table of longest sections. */
+  if (cycles <= st->top[IRQSOFF_TOP - 1].cycles)
+    return;
+  for (i = IRQSOFF_TOP - 1; i > 0 && st->top[i - 1].cycles < cycles; i--)
+    st->top[i] = st->top[i - 1];
+  st->top[i].cycles = cycles;
+  st->top[i].off_site = st->off_site;
+  st->top[i].on_site = site;
+}
+
+/* Ends the current CPU's interrupts-off section, for code that
+   is about to turn interrupts on without intr_enable(), such as
+   the idle thread's `sti; hlt'.  Interrupts must be off. */
+void
+irqsoff_stop (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  irqsoff_end (__builtin_return_address (0));
+}
+
+/* Prints the longest interrupts-off sections over all CPUs and
+   the histogram of their lengths.  Code addresses can be turned
+   into function names with the "backtrace" utility. */
+void
+irqsoff_print_stats (void)
+{
+  struct irqsoff_section top[IRQSOFF_TOP];
+  int top_cpu[IRQSOFF_TOP];
+  uint64_t hist[IRQSOFF_BUCKETS];
+  uint64_t cnt = 0;
+  int cpu, i, j, k;
+
+  memset (top, 0, sizeof top);
+  memset (hist, 0, sizeof hist);
+  for (cpu = 0; cpu < cpu_cnt; cpu++)
+    {
+      const struct irqsoff_stats *st = &irqsoff_stats[cpu];
+
+      cnt += st->cnt;
+      for (i = 0; i < IRQSOFF_BUCKETS; i++)
+        hist[i] += st->hist[i];
+      for (i = 0; i < IRQSOFF_TOP && st->top[i].cycles != 0; i++)
+        for (j = 0; j < IRQSOFF_TOP; j++)
+          if (st->top[i].cycles > top[j].cycles)
+            {
+              for (k = IRQSOFF_TOP - 1; k > j; k--)
+                {
+                  top[k] = top[k - 1];
+                  top_cpu[k] = top_cpu[k - 1];
+                }
+              top[j] = st->top[i];
+              top_cpu[j] = cpu;
+              break;
+            }
+    }
+
+  printf ("Interrupts-off statistics: %"PRIu64" sections"
+          " (times in cycles, TSC at %"PRIu64" Hz).\n",
+          cnt, clock_tsc_hz ());
+  for (i = 0; i < IRQSOFF_TOP && top[i].cycles != 0; i++)
+    printf ("irqsoff: %12"PRIu64" cycles %8"PRId64" us cpu %d"
+            " off at %p on at %p\n",
+            top[i].cycles, clock_tsc_to_ns (top[i].cycles) / 1000,
+            top_cpu[i], top[i].off_site, top[i].on_site);
+  for (i = 0; i < IRQSOFF_BUCKETS; i++)
+    if (hist[i] != 0)
+      printf ("irqsoff: >= %12"PRIu64" cycles: %"PRIu64"\n",
+              (uint64_t) 1 << i, hist[i]);
+}
+#endif /* IRQSOFF */
@@ -58,6 +58,7 @@ struct intr_frame
 typedef void intr_handler_func (struct intr_frame *);
 
 void intr_init (void);
+void intr_init_ap (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
@@ -67,4 +68,11 @@ void intr_yield_on_return (void);
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
+#ifdef IRQSOFF
+/* Built with "make IRQSOFF=1": times every section of code that
+   runs with interrupts off.  See interrupt.c. */
+void irqsoff_stop (void);
+void irqsoff_print_stats (void);
+#endif
+
 #endif /* threads/interrupt.h */
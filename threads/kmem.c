@@ -0,0 +1,285 @@
+#include "threads/kmem.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab1e55
+
+/* End of a slab's free list. */
+#define SLAB_END UINT16_MAX
+
+/* A slab.  The header is at the start of the slab's page,
+   followed by the objects.  The free objects are linked through
+   `next', by index, so that their contents stay as the
+   constructor left them. */
+struct slab
+  {
+    unsigned magic;                     /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;           /* Owning cache. */
+    struct list_elem elem;              /* Element in cache's full, partial,
+                                           or empty list. */
+    size_t in_use;                      /* Number of objects in use. */
+    uint16_t free;                      /* First free object, or SLAB_END. */
+    uint16_t next[];                    /* Free object after each object. */
+  };
+
+/* All caches.  Caches are never destroyed, so the list only
+   grows. */
+static struct list cache_list = LIST_INITIALIZER (cache_list);
+static struct spinlock cache_list_lock;
+
+static size_t obj_ofs (size_t obj_cnt);
+static struct slab *new_slab (struct kmem_cache *);
+static void *slab_obj (struct kmem_cache *, struct slab *, size_t idx);
+
+/* Initializes C as a cache, named NAME, of objects of SIZE
+   bytes.  If CTOR is nonnull, it is called on each object when
+   it is created. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+                 kmem_ctor *ctor)
+{
+  enum intr_level old_level;
+
+  ASSERT (size > 0);
+
+  c->name = name;
+  c->size = ROUND_UP (size, sizeof (void *));
+  c->obj_cnt = (PGSIZE - sizeof (struct slab)) / (c->size + sizeof (uint16_t));
+  while (obj_ofs (c->obj_cnt) + c->obj_cnt * c->size > PGSIZE)
+    c->obj_cnt--;
+  ASSERT (c->obj_cnt > 0 && c->obj_cnt < SLAB_END);
+  c->obj_ofs = obj_ofs (c->obj_cnt);
+  c->ctor = ctor;
+
+  spinlock_init (&c->lock);
+  list_init (&c->full);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  c->peak_slab_cnt = 0;
+  c->reclaim_cnt = 0;
+
+  old_level = intr_disable ();
+  spin_lock (&cache_list_lock);
+  list_push_back (&cache_list, &c->elem);
+  spin_unlock (&cache_list_lock);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  enum intr_level old_level;
+  struct slab *s;
+  size_t idx;
+
+  old_level = intr_disable ();
+  spin_lock (&c->lock);
+  if (list_empty (&c->partial) && list_empty (&c->empty))
+    {
+      /* Create a slab without the lock, because constructing
+         its objects may take a while. */
+      spin_unlock (&c->lock);
+      intr_set_level (old_level);
+      s = new_slab (c);
+      if (s == NULL)
+        return NULL;
+
+      old_level = intr_disable ();
+      spin_lock (&c->lock);
+      list_push_back (&c->empty, &s->elem);
+      if (++c->slab_cnt > c->peak_slab_cnt)
+        c->peak_slab_cnt = c->slab_cnt;
+    }
+
+  /* Fill partial slabs first, so that empty slabs stay empty and
+     can be reclaimed. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  idx = s->free;
+  s->free = s->next[idx];
+  s->in_use++;
+  c->in_use++;
+  if (s->free == SLAB_END)
+    {
+      list_remove (&s->elem);
+      list_push_back (&c->full, &s->elem);
+    }
+  spin_unlock (&c->lock);
+  intr_set_level (old_level);
+
+  return slab_obj (c, s, idx);
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  enum intr_level old_level;
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  idx = (pg_ofs (obj) - c->obj_ofs) / c->size;
+  ASSERT (obj == slab_obj (c, s, idx));
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->size);
+#endif
+
+  old_level = intr_disable ();
+  spin_lock (&c->lock);
+  ASSERT (s->in_use > 0);
+  s->next[idx] = s->free;
+  s->free = idx;
+  s->in_use--;
+  c->in_use--;
+  if (s->in_use == 0 || s->in_use == c->obj_cnt - 1)
+    {
+      list_remove (&s->elem);
+      list_push_front (s->in_use == 0 ? &c->empty : &c->partial, &s->elem);
+    }
+  spin_unlock (&c->lock);
+  intr_set_level (old_level);
+}
+
+/* Frees the empty slabs of every cache.  Returns the number of
+   pages freed.  May be called with interrupts off. */
+size_t
+kmem_reclaim (void)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  size_t page_cnt = 0;
+
+  old_level = intr_disable ();
+  spin_lock (&cache_list_lock);
+  for (e = list_begin (&cache_list); e != list_end (&cache_list);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      struct list empty;
+
+      list_init (&empty);
+      spin_lock (&c->lock);
+      while (!list_empty (&c->empty))
+        {
+          list_push_back (&empty, list_pop_front (&c->empty));
+          c->slab_cnt--;
+          c->reclaim_cnt++;
+        }
+      spin_unlock (&c->lock);
+
+      while (!list_empty (&empty))
+        {
+          struct slab *s = list_entry (list_pop_front (&empty),
+                                       struct slab, elem);
+          s->magic = 0;
+          palloc_free_page (s);
+          page_cnt++;
+        }
+    }
+  spin_unlock (&cache_list_lock);
+  intr_set_level (old_level);
+
+  return page_cnt;
+}
+
+/* Prints statistics about each cache. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  /* Caches are never removed from cache_list, so it is safe to
+     walk it without the lock, which printing must not hold. */
+  for (e = list_begin (&cache_list); e != list_end (&cache_list);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      enum intr_level old_level;
+      size_t in_use, slab_cnt, peak_slab_cnt, reclaim_cnt;
+
+      old_level = intr_disable ();
+      spin_lock (&c->lock);
+      in_use = c->in_use;
+      slab_cnt = c->slab_cnt;
+      peak_slab_cnt = c->peak_slab_cnt;
+      reclaim_cnt = c->reclaim_cnt;
+      spin_unlock (&c->lock);
+      intr_set_level (old_level);
+
+      printf ("Kmem: %s: %zu-byte objects, %zu of %zu in use, "
+              "%zu slabs (peak %zu, %zu reclaimed), %zu bytes unused\n",
+              c->name, c->size, in_use, slab_cnt * c->obj_cnt,
+              slab_cnt, peak_slab_cnt, reclaim_cnt,
+              slab_cnt * PGSIZE - in_use * c->size);
+    }
+}
+
+/* Returns the offset of the first object in a slab that holds
+   OBJ_CNT objects. */
+static size_t
+obj_ofs (size_t obj_cnt)
+{
+  return ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+                   sizeof (void *));
+}
+
+/* Creates and returns a new slab for cache C, with all of its
+   objects free and constructed, or returns a null pointer if
+   memory is not available. */
+static struct slab *
+new_slab (struct kmem_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free = 0;
+  for (i = 0; i < c->obj_cnt; i++)
+    {
+      s->next[i] = i + 1 < c->obj_cnt ? i + 1 : SLAB_END;
+      if (c->ctor != NULL)
+        c->ctor (slab_obj (c, s, i));
+    }
+  return s;
+}
+
+/* Returns object IDX in slab S of cache C. */
+static void *
+slab_obj (struct kmem_cache *c, struct slab *s, size_t idx)
+{
+  ASSERT (idx < c->obj_cnt);
+  return (uint8_t *) s + c->obj_ofs + idx * c->size;
+}
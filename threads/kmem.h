@@ -0,0 +1,52 @@
+#ifndef THREADS_KMEM_H
+#define THREADS_KMEM_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/spinlock.h"
+
+/* Object caches.
+
+   A kmem_cache hands out objects of a single size, for
+   structures that the kernel allocates and frees often.  Objects
+   are carved from pages, called "slabs", with no per-object
+   header and no rounding up to a power of 2, as malloc() does.
+
+   If the cache has a constructor, it is called on each object
+   once, when its slab is created, not on every allocation.  An
+   object must therefore be freed in its constructed state.
+
+   A cache keeps the slabs that become empty, for later
+   allocations.  When the kernel pool runs out of pages, the page
+   allocator calls kmem_reclaim() to free them. */
+
+typedef void kmem_ctor (void *obj);
+
+struct kmem_cache
+  {
+    const char *name;                   /* Name, for statistics. */
+    size_t size;                        /* Object size, rounded up. */
+    size_t obj_cnt;                     /* Number of objects per slab. */
+    size_t obj_ofs;                     /* Offset of first object in slab. */
+    kmem_ctor *ctor;                    /* Constructor, or null. */
+    struct list_elem elem;              /* Element in list of all caches. */
+
+    struct spinlock lock;               /* Protects the members below. */
+    struct list full;                   /* Slabs with no free objects. */
+    struct list partial;                /* Slabs with some free objects. */
+    struct list empty;                  /* Slabs with no objects in use. */
+    size_t slab_cnt;                    /* Number of slabs. */
+    size_t in_use;                      /* Number of objects in use. */
+    size_t peak_slab_cnt;               /* Greatest slab_cnt so far. */
+    size_t reclaim_cnt;                 /* Number of slabs reclaimed. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+
+size_t kmem_reclaim (void);
+void kmem_print_stats (void);
+
+#endif /* threads/kmem.h */
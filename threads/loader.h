@@ -8,6 +8,12 @@
 /* Physical address of kernel base. */
 #define LOADER_KERN_BASE 0x20000       /* 128 kB. */
 
+/* Physical address to which threads/ap-start.S is copied for
+   starting application processors.  Must be page-aligned, below
+   1 MB, and clear of the loader, whose copy of the command line
+   is still in use. */
+#define AP_START_PADDR 0x7000
+
 /* Kernel virtual address at which all physical memory is mapped.
    Must be aligned on a 4 MB boundary. */
 #define LOADER_PHYS_BASE 0xc0000000     /* 3 GB. */
@@ -5,19 +5,24 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages
+   blocks of that size.  There are four size classes between
+   each pair of powers of 2 (16, 24, 32, 40, 48, 56, 64, 80, 96,
+   ...), so that no more than a fifth of a block is wasted, and a
+   table maps a request size to its descriptor in constant time.
+   The descriptor keeps a list of free blocks.  If the free list
+   is nonempty, one of its blocks is used to satisfy the request.
 
-   Otherwise, a new page of memory, called an "arena", is
+   Otherwise, a new chunk of memory, called an "arena", is
    obtained from the page allocator (if none is available,
    malloc() returns a null pointer).  The new arena is divided
    into blocks, all of which are added to the descriptor's free
@@ -28,19 +33,46 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   "Small" blocks, up to SMALL_MAX bytes, come from single-page
+   arenas, and free() finds a block's arena at the start of its
+   page.  "Medium" blocks, up to MEDIUM_MAX bytes, are too big for
+   that to waste little space, so they come from arenas of
+   several pages, and each is preceded by a header that points to
+   its arena.  Small blocks are at page offsets 4 more than a
+   multiple of 8, because struct arena is 12 bytes long and block
+   sizes are multiples of 8, and medium blocks at multiples of 8,
+   which is how free() tells them apart.
+
+   We handle "big" blocks, over MEDIUM_MAX bytes, by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's
+   arena header. */
+
+/* Largest small and medium block sizes. */
+#define SMALL_MAX 1024
+#define MEDIUM_MAX 16384
+
+/* Most pages in a medium arena, unless fewer cannot hold two
+   blocks. */
+#define MEDIUM_ARENA_PAGES 8
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t arena_pages;         /* Number of pages in an arena. */
+    bool medium;                /* Medium blocks, with headers? */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    char name[16];              /* Name of `lock', e.g. "malloc 16". */
+
+    /* Statistics, protected by `lock'. */
+    size_t live_cnt;            /* Blocks in use. */
+    size_t peak_cnt;            /* Greatest live_cnt. */
+    size_t arena_cnt;           /* Arenas. */
+    unsigned long long alloc_cnt;  /* Blocks ever allocated. */
+    unsigned long long req_bytes;  /* Bytes ever requested. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -54,6 +86,16 @@ struct arena
     size_t free_cnt;            /* Free blocks; pages in big block. */
   };
 
+/* Offset of the first medium block's header in its arena. */
+#define MEDIUM_OFS 16
+
+/* Header that precedes each medium block. */
+struct block_header
+  {
+    struct arena *arena;        /* Arena that holds the block. */
+    unsigned magic;             /* Always set to ARENA_MAGIC. */
+  };
+
 /* Free block. */
 struct block 
   {
@@ -61,9 +103,21 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[40];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index in descs[] of the descriptor for each request size,
+   rounded up to a multiple of 8 bytes for small blocks and of
+   256 bytes for medium blocks. */
+static uint8_t small_class[SMALL_MAX / 8 + 1];
+static uint8_t medium_class[MEDIUM_MAX / 256 + 1];
+
+/* Statistics for big blocks. */
+static struct spinlock big_lock;
+static size_t big_live_pages, big_peak_pages;
+
+static void init_desc (size_t block_size);
+static struct desc *size_to_desc (size_t size);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -71,16 +125,36 @@ static struct block *arena_to_block (struct arena *, size_t idx);
 void
 malloc_init (void) 
 {
-  size_t block_size;
-
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  size_t power, i;
+
+  ASSERT (sizeof (struct arena) % 8 == 4);
+  ASSERT (sizeof (struct block_header) == 8);
+
+  /* Four size classes per power of 2, each rounded up to a
+     multiple of 8. */
+  for (power = 16; power <= MEDIUM_MAX; power *= 2)
+    for (i = 4; i < 8; i++)
+      {
+        size_t block_size = ROUND_UP (power * i / 4, 8);
+        if (block_size < 2 * power && block_size <= MEDIUM_MAX
+            && (desc_cnt == 0 || block_size > descs[desc_cnt - 1].block_size))
+          init_desc (block_size);
+      }
+
+  /* Fill in the lookup tables. */
+  for (i = 0; i < desc_cnt; i++)
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      struct desc *d = &descs[i];
+      size_t prev = i > 0 ? descs[i - 1].block_size : 0;
+      size_t size;
+
+      if (!d->medium)
+        for (size = ROUND_UP (prev + 1, 8); size <= d->block_size; size += 8)
+          small_class[size / 8] = i;
+      else
+        for (size = ROUND_UP (prev + 1, 256); size <= d->block_size;
+             size += 256)
+          medium_class[size / 256] = i;
     }
 }
 
@@ -99,18 +173,26 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL)
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+      enum intr_level old_level;
+
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
 
+      old_level = intr_disable ();
+      spin_lock (&big_lock);
+      big_live_pages += page_cnt;
+      if (big_live_pages > big_peak_pages)
+        big_peak_pages = big_live_pages;
+      spin_unlock (&big_lock);
+      intr_set_level (old_level);
+
       /* Initialize the arena to indicate a big block of PAGE_CNT
          pages, and return it. */
       a->magic = ARENA_MAGIC;
@@ -126,8 +208,8 @@ malloc (size_t size)
     {
       size_t i;
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
+      /* Allocate pages. */
+      a = palloc_get_multiple (0, d->arena_pages);
       if (a == NULL) 
         {
           lock_release (&d->lock);
@@ -141,14 +223,25 @@ malloc (size_t size)
       for (i = 0; i < d->blocks_per_arena; i++) 
         {
           struct block *b = arena_to_block (a, i);
+          if (d->medium)
+            {
+              struct block_header *h = (struct block_header *) b - 1;
+              h->arena = a;
+              h->magic = ARENA_MAGIC;
+            }
           list_push_back (&d->free_list, &b->free_elem);
         }
+      d->arena_cnt++;
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  if (++d->live_cnt > d->peak_cnt)
+    d->peak_cnt = d->live_cnt;
+  d->alloc_cnt++;
+  d->req_bytes += size;
   lock_release (&d->lock);
   return b;
 }
@@ -237,6 +330,7 @@ free (void *p)
 
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
+          d->live_cnt--;
 
           /* If the arena is now entirely unused, free it. */
           if (++a->free_cnt >= d->blocks_per_arena) 
@@ -249,7 +343,8 @@ free (void *p)
                   struct block *b = arena_to_block (a, i);
                   list_remove (&b->free_elem);
                 }
-              palloc_free_page (a);
+              palloc_free_multiple (a, d->arena_pages);
+              d->arena_cnt--;
             }
 
           lock_release (&d->lock);
@@ -257,25 +352,148 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          enum intr_level old_level = intr_disable ();
+          spin_lock (&big_lock);
+          big_live_pages -= a->free_cnt;
+          spin_unlock (&big_lock);
+          intr_set_level (old_level);
+
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Prints statistics about each size class that has been used:
+   the blocks in use now and at most, the pages in its arenas,
+   and the percentage of the bytes in all of the blocks it has
+   handed out that went unused because of rounding up.
+
+   This is called at shutdown, possibly with interrupts off, so it
+   cannot take the descriptors' locks and reads them unlocked. */
+void
+malloc_print_stats (void)
+{
+  size_t total_pages = 0;
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct desc *d = &descs[i];
+      size_t live_cnt, peak_cnt, pages;
+      unsigned long long alloc_cnt, req_bytes, block_bytes;
+
+      live_cnt = d->live_cnt;
+      peak_cnt = d->peak_cnt;
+      pages = d->arena_cnt * d->arena_pages;
+      alloc_cnt = d->alloc_cnt;
+      req_bytes = d->req_bytes;
+
+      total_pages += pages;
+      if (alloc_cnt == 0)
+        continue;
+      block_bytes = alloc_cnt * d->block_size;
+      printf ("Malloc: %5zu-byte blocks: %zu live (%zu bytes), "
+              "peak %zu (%zu bytes), %zu pages, %llu%% wasted\n",
+              d->block_size, live_cnt, live_cnt * d->block_size,
+              peak_cnt, peak_cnt * d->block_size, pages,
+              (block_bytes - req_bytes) * 100 / block_bytes);
+    }
+  printf ("Malloc: %zu pages in arenas, %zu in big blocks (peak %zu)\n",
+          total_pages, big_live_pages, big_peak_pages);
+}
+
+/* Initializes the next descriptor, for blocks of BLOCK_SIZE
+   bytes. */
+static void
+init_desc (size_t block_size)
+{
+  struct desc *d = &descs[desc_cnt++];
+
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  ASSERT (block_size % 8 == 0);
+
+  d->block_size = block_size;
+  d->medium = block_size > SMALL_MAX;
+  if (!d->medium)
+    {
+      d->arena_pages = 1;
+      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+    }
+  else
+    {
+      /* Use the fewest pages that hold two blocks, adding pages
+         while more than an eighth of the arena would be wasted,
+         up to MEDIUM_ARENA_PAGES. */
+      size_t slot_size = block_size + sizeof (struct block_header);
+      size_t best_waste = SIZE_MAX;
+      size_t pages;
+
+      for (pages = DIV_ROUND_UP (MEDIUM_OFS + 2 * slot_size, PGSIZE); ;
+           pages++)
+        {
+          size_t cnt = (pages * PGSIZE - MEDIUM_OFS) / slot_size;
+          size_t waste = pages * PGSIZE - MEDIUM_OFS - cnt * slot_size;
+
+          if (best_waste == SIZE_MAX
+              || waste * d->arena_pages < best_waste * pages)
+            {
+              d->arena_pages = pages;
+              d->blocks_per_arena = cnt;
+              best_waste = waste;
+            }
+          if (waste * 8 <= pages * PGSIZE || pages >= MEDIUM_ARENA_PAGES)
+            break;
+        }
+    }
+  list_init (&d->free_list);
+  snprintf (d->name, sizeof d->name, "malloc %zu", block_size);
+  lock_init (&d->lock, d->name);
+  d->live_cnt = d->peak_cnt = d->arena_cnt = 0;
+  d->alloc_cnt = d->req_bytes = 0;
+}
+
+/* Returns the descriptor for SIZE-byte requests, or a null
+   pointer if SIZE is too big for any descriptor. */
+static struct desc *
+size_to_desc (size_t size)
+{
+  if (size <= SMALL_MAX)
+    return &descs[small_class[DIV_ROUND_UP (size, 8)]];
+  else if (size <= MEDIUM_MAX)
+    return &descs[medium_class[DIV_ROUND_UP (size, 256)]];
+  else
+    return NULL;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
 {
-  struct arena *a = pg_round_down (b);
+  struct arena *a;
+
+  if (pg_ofs (b) % 8 == 0)
+    {
+      /* Medium block. */
+      struct block_header *h = (struct block_header *) b - 1;
+      ASSERT (h->magic == ARENA_MAGIC);
+      a = h->arena;
+    }
+  else
+    a = pg_round_down (b);
 
   /* Check that the arena is valid. */
   ASSERT (a != NULL);
   ASSERT (a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
-  ASSERT (a->desc == NULL
+  ASSERT (a->desc == NULL || a->desc->medium
           || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+  ASSERT (a->desc == NULL
+          || !a->desc->medium
+          || ((uint8_t *) b - (uint8_t *) a - MEDIUM_OFS
+              - sizeof (struct block_header))
+             % (a->desc->block_size + sizeof (struct block_header)) == 0);
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
@@ -285,10 +503,20 @@ block_to_arena (struct block *b)
 static struct block *
 arena_to_block (struct arena *a, size_t idx) 
 {
+  struct desc *d;
+
   ASSERT (a != NULL);
   ASSERT (a->magic == ARENA_MAGIC);
-  ASSERT (idx < a->desc->blocks_per_arena);
-  return (struct block *) ((uint8_t *) a
-                           + sizeof *a
-                           + idx * a->desc->block_size);
+  d = a->desc;
+  ASSERT (idx < d->blocks_per_arena);
+  if (!d->medium)
+    return (struct block *) ((uint8_t *) a
+                             + sizeof *a
+                             + idx * d->block_size);
+  else
+    return (struct block *) ((uint8_t *) a
+                             + MEDIUM_OFS
+                             + idx * (d->block_size
+                                      + sizeof (struct block_header))
+                             + sizeof (struct block_header));
 }
@@ -2,12 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/kmem.h"
 #include "threads/loader.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -23,14 +28,80 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  Numbering the
+   pages of a pool from 0, a block of order K is 2**K pages that
+   start at a page number that is a multiple of 2**K.  Its buddy
+   is the other half of the block of order K + 1 that contains
+   it.  Each pool keeps a list of its free blocks of each order.
+   Allocating N pages takes a free block of the smallest order
+   that fits, splitting a bigger one in halves as needed, and
+   frees the pages past the first N again.  Freeing a block
+   merges it with its buddy, if that is free as a whole, and then
+   does the same with the merged block.  Both take O(lg n) time
+   for a pool of n pages.
+
+   Most allocations are of single pages, so each CPU also keeps a
+   magazine of free pages from each pool (see struct palloc_mag).
+   A single page is taken from and freed into the running CPU's
+   magazine with interrupts off but without the pool's lock or
+   any bitmap work.  An empty magazine is refilled, and a full
+   one half flushed, MAG_BATCH pages at a time under one
+   acquisition of the lock.  Pages in magazines count as
+   allocated in the pool's used_map.  Each magazine also has a
+   spin lock of its own, which only its CPU takes, except when a
+   CPU that runs out of pages drains every magazine back into
+   the pool.
+
+   With LOCKSTAT defined, acquisitions of each pool's lock are
+   counted in the lock statistics under the pool's name.
+
+   Many single pages are requested with PAL_ZERO, so idle CPUs
+   also zero free pages in advance (see palloc_zero_idle()).  Each
+   pool keeps a stack of up to ZERO_HIGH pages known to be all
+   zeros.  Once it falls below ZERO_LOW pages, idle threads take
+   pages from the pool and zero them, one at a time, until it is
+   back up to ZERO_HIGH.  A PAL_ZERO request for a single page
+   takes a page from the stack, if there is one, instead of
+   zeroing one itself.  Other requests take pages from the stack
+   only when the pool has none left.  Pages on the stack also
+   count as allocated. */
+
+/* Number of block orders.  The largest block is 2**19 pages. */
+#define ORDER_CNT 20
+
+/* Entry in a pool's `orders' for a page that does not start a
+   free block. */
+#define NOT_FREE 0xff
+
+/* Number of pages moved between a magazine and its pool at a
+   time. */
+#define MAG_BATCH (PALLOC_MAG_SIZE / 2)
+
+/* Low and high watermarks on each pool's number of zeroed
+   pages. */
+#define ZERO_LOW 16
+#define ZERO_HIGH 64
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    struct spinlock lock;               /* Mutual exclusion. */
+#ifdef LOCKSTAT
+    struct lockstat *stat;              /* Statistics for `lock'. */
+    uint64_t acquire_time;              /* When `lock' was acquired. */
+#endif
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *orders;                    /* Order of free block at each page. */
+    struct list free[ORDER_CNT];        /* Free blocks of each order. */
+    size_t page_cnt;                    /* Number of pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    void *zeroed[ZERO_HIGH];            /* Pages that are all zeros. */
+    size_t zeroed_cnt;                  /* Number of pages in zeroed. */
+    size_t zero_pending;                /* Pages being zeroed. */
+    bool zero_refill;                   /* Zeroing up to ZERO_HIGH? */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,7 +109,24 @@ static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
+static void pool_lock (struct pool *);
+static void pool_unlock (struct pool *);
 static bool page_from_pool (const struct pool *, void *page);
+static void *take_pages (struct pool *, size_t page_cnt);
+static void *get_pages (struct pool *, size_t page_cnt);
+static void put_pages (struct pool *, void *pages, size_t page_cnt);
+static struct palloc_mag *cpu_mag (struct pool *);
+static void *mag_get (struct pool *);
+static void mag_put (struct pool *, void *page);
+static void mag_flush (struct pool *, struct palloc_mag *, size_t cnt);
+static void mag_drain (struct pool *);
+static void *zero_get (struct pool *);
+static void zero_flush (struct pool *);
+static bool zero_page (struct pool *);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void print_pool_stats (struct pool *, const char *name);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -66,30 +154,44 @@ palloc_init (size_t user_page_limit)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  Before giving up on
+   the kernel pool, frees the empty slabs of the object caches
+   (see kmem.h). */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
-  size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if ((flags & PAL_ZERO) && page_cnt == 1)
+    {
+      /* Use a page that is already zeroed, if there is one. */
+      old_level = intr_disable ();
+      pages = zero_get (pool);
+      if (pages != NULL)
+        cpu_current ()->zero_hits++;
+      intr_set_level (old_level);
+      if (pages != NULL)
+        return pages;
+    }
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  pages = take_pages (pool, page_cnt);
+  if (pages == NULL && pool == &kernel_pool && kmem_reclaim () > 0)
+    pages = take_pages (pool, page_cnt);
 
   if (pages != NULL) 
     {
       if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+        {
+          old_level = intr_disable ();
+          cpu_current ()->zero_misses += page_cnt;
+          intr_set_level (old_level);
+          memset (pages, 0, PGSIZE * page_cnt);
+        }
     }
   else 
     {
@@ -113,12 +215,13 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
+/* Frees the PAGE_CNT pages starting at PAGES.  They need not be
+   exactly the pages of one allocation. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
-  size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -131,14 +234,16 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   else
     NOT_REACHED ();
 
-  page_idx = pg_no (pages) - pg_no (pool->base);
-
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  if (page_cnt == 1)
+    mag_put (pool, pages);
+  else
+    put_pages (pool, pages, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +253,114 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page in advance, if either pool is short of
+   zeroed pages, and returns true if it did.  Called by the idle
+   thread with interrupts off.  Interrupts are on while the page
+   is being zeroed, so the idle thread should look for other work
+   to do afterward. */
+bool
+palloc_zero_idle (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
+/* Prints statistics about the magazines and about pages zeroed
+   in advance. */
+void
+palloc_print_stats (void)
+{
+  long long hits = 0, misses = 0;
+  long long zero_hits = 0, zero_misses = 0, zero_idle = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      hits += cpus[i].mag_hits;
+      misses += cpus[i].mag_misses;
+      zero_hits += cpus[i].zero_hits;
+      zero_misses += cpus[i].zero_misses;
+      zero_idle += cpus[i].zero_idle;
+    }
+  printf ("Palloc: %lld page cache hits, %lld misses\n", hits, misses);
+  printf ("Palloc: %lld pages zeroed while idle, "
+          "%lld zeroed pages used, %lld zeroed on demand\n",
+          zero_idle, zero_hits, zero_misses);
+}
+
+/* Prints the free space in each pool and how it is broken up
+   into blocks. */
+void
+palloc_print_pools (void)
+{
+  print_pool_stats (&kernel_pool, "kernel pool");
+  print_pool_stats (&user_pool, "user pool");
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and orders at its base.
+     Calculate the space needed for them and subtract it from
+     the pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  spinlock_init (&p->lock);
+#ifdef LOCKSTAT
+  p->stat = lockstat_get (name);
+#endif
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->orders = (uint8_t *) base + bm_size;
+  memset (p->orders, NOT_FREE, page_cnt);
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free[order]);
+  p->page_cnt = page_cnt;
+  p->base = base + meta_pages * PGSIZE;
+  p->zeroed_cnt = p->zero_pending = 0;
+  p->zero_refill = false;
+  free_pages (p, 0, page_cnt);
+}
+
+/* Acquires POOL's lock.  Interrupts must be off. */
+static void
+pool_lock (struct pool *pool)
+{
+#ifdef LOCKSTAT
+  uint64_t start = rdtsc ();
+  bool contended = !spin_trylock (&pool->lock);
+
+  if (contended)
+    spin_lock (&pool->lock);
+  pool->acquire_time = rdtsc ();
+  lockstat_acquired (pool->stat, contended, pool->acquire_time - start);
+#else
+  spin_lock (&pool->lock);
+#endif
+}
+
+/* Releases POOL's lock. */
+static void
+pool_unlock (struct pool *pool)
+{
+#ifdef LOCKSTAT
+  uint64_t hold = rdtsc () - pool->acquire_time;
+
+  spin_unlock (&pool->lock);
+  lockstat_released (pool->stat, hold);
+#else
+  spin_unlock (&pool->lock);
+#endif
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +370,393 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Takes PAGE_CNT contiguous pages from POOL, through the running
+   CPU's magazine if PAGE_CNT is 1, and returns the first, or a
+   null pointer if none are available. */
+static void *
+take_pages (struct pool *pool, size_t page_cnt)
+{
+  enum intr_level old_level;
+  void *pages;
+
+  old_level = intr_disable ();
+  if (page_cnt == 1)
+    {
+      pages = mag_get (pool);
+      if (pages == NULL)
+        pages = zero_get (pool);
+      if (pages == NULL)
+        {
+          /* Other CPUs' magazines may still hold free pages. */
+          mag_drain (pool);
+          pages = mag_get (pool);
+        }
+    }
+  else
+    {
+      pages = get_pages (pool, page_cnt);
+      if (pages == NULL)
+        {
+          /* Pages cached in the magazines, or zeroed in advance,
+             might complete a block that is big enough. */
+          mag_drain (pool);
+          zero_flush (pool);
+          pages = get_pages (pool, page_cnt);
+        }
+    }
+  intr_set_level (old_level);
+  return pages;
+}
+
+/* Removes PAGE_CNT contiguous pages from POOL and returns the
+   first, or a null pointer if no free block is big enough.
+   Interrupts must be off. */
+static void *
+get_pages (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+
+  pool_lock (pool);
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  pool_unlock (pool);
+
+  return page_idx != BITMAP_ERROR ? pool->base + PGSIZE * page_idx : NULL;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGES to POOL.
+   Interrupts must be off. */
+static void
+put_pages (struct pool *pool, void *pages, size_t page_cnt)
+{
+  size_t page_idx = pg_no (pages) - pg_no (pool->base);
+
+  pool_lock (pool);
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+  pool_unlock (pool);
+}
+
+/* Returns the running CPU's magazine for POOL.  Interrupts must
+   be off. */
+static struct palloc_mag *
+cpu_mag (struct pool *pool)
+{
+  return &cpu_current ()->mags[pool == &user_pool];
+}
+
+/* Takes a page from the running CPU's magazine for POOL,
+   refilling it from POOL if it is empty.  Returns a null pointer
+   if POOL has no free pages either.  Interrupts must be off. */
+static void *
+mag_get (struct pool *pool)
+{
+  struct cpu *c = cpu_current ();
+  struct palloc_mag *mag = cpu_mag (pool);
+  void *page = NULL;
+
+  spin_lock (&mag->lock);
+  if (mag->cnt > 0)
+    c->mag_hits++;
+  else
+    {
+      c->mag_misses++;
+      pool_lock (pool);
+      while (mag->cnt < MAG_BATCH)
+        {
+          size_t page_idx = alloc_pages (pool, 1);
+          if (page_idx == BITMAP_ERROR)
+            break;
+          bitmap_mark (pool->used_map, page_idx);
+          mag->pages[mag->cnt++] = pool->base + PGSIZE * page_idx;
+        }
+      pool_unlock (pool);
+    }
+  if (mag->cnt > 0)
+    page = mag->pages[--mag->cnt];
+  spin_unlock (&mag->lock);
+  return page;
+}
+
+/* Puts PAGE, which came from POOL, into the running CPU's
+   magazine for POOL, first flushing half of the magazine to
+   POOL if it is full.  Interrupts must be off. */
+static void
+mag_put (struct pool *pool, void *page)
+{
+  struct palloc_mag *mag = cpu_mag (pool);
+
+#ifndef NDEBUG
+  size_t i;
+#endif
+
+  spin_lock (&mag->lock);
+#ifndef NDEBUG
+  for (i = 0; i < mag->cnt; i++)
+    ASSERT (mag->pages[i] != page);
+#endif
+
+  if (mag->cnt == PALLOC_MAG_SIZE)
+    mag_flush (pool, mag, MAG_BATCH);
+  mag->pages[mag->cnt++] = page;
+  spin_unlock (&mag->lock);
+}
+
+/* Returns the CNT least recently freed pages in MAG to POOL.
+   MAG's lock must be held. */
+static void
+mag_flush (struct pool *pool, struct palloc_mag *mag, size_t cnt)
+{
+  size_t i;
+
+  ASSERT (cnt <= mag->cnt);
+
+  pool_lock (pool);
+  for (i = 0; i < cnt; i++)
+    {
+      size_t page_idx = pg_no (mag->pages[i]) - pg_no (pool->base);
+      ASSERT (bitmap_test (pool->used_map, page_idx));
+      bitmap_reset (pool->used_map, page_idx);
+      free_pages (pool, page_idx, 1);
+    }
+  pool_unlock (pool);
+
+  mag->cnt -= cnt;
+  memmove (mag->pages, mag->pages + cnt, sizeof *mag->pages * mag->cnt);
+}
+
+/* Returns every page in every CPU's magazine for POOL to POOL.
+   Interrupts must be off. */
+static void
+mag_drain (struct pool *pool)
+{
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct palloc_mag *mag = &cpus[i].mags[pool == &user_pool];
+
+      spin_lock (&mag->lock);
+      if (mag->cnt > 0)
+        mag_flush (pool, mag, mag->cnt);
+      spin_unlock (&mag->lock);
+    }
+}
+
+/* Takes a page from POOL's zeroed pages and returns it, or a
+   null pointer if there are none.  Interrupts must be off. */
+static void *
+zero_get (struct pool *pool)
+{
+  void *page = NULL;
+
+  /* Skip the lock in the common case of no zeroed pages. */
+  if (pool->zeroed_cnt == 0)
+    return NULL;
+
+  pool_lock (pool);
+  if (pool->zeroed_cnt > 0)
+    page = pool->zeroed[--pool->zeroed_cnt];
+  pool_unlock (pool);
+  return page;
+}
+
+/* Returns all of POOL's zeroed pages to its free blocks.
+   Interrupts must be off. */
+static void
+zero_flush (struct pool *pool)
+{
+  pool_lock (pool);
+  while (pool->zeroed_cnt > 0)
+    {
+      void *page = pool->zeroed[--pool->zeroed_cnt];
+      size_t page_idx = pg_no (page) - pg_no (pool->base);
+      ASSERT (bitmap_test (pool->used_map, page_idx));
+      bitmap_reset (pool->used_map, page_idx);
+      free_pages (pool, page_idx, 1);
+    }
+  pool_unlock (pool);
+}
+
+/* Zeroes a free page from POOL and adds it to POOL's zeroed
+   pages, if POOL is refilling them, and returns true if it did.
+   Interrupts must be off, but are turned on while the page is
+   being zeroed. */
+static bool
+zero_page (struct pool *pool)
+{
+  size_t page_idx = BITMAP_ERROR;
+  size_t cnt;
+  void *page;
+
+  pool_lock (pool);
+  cnt = pool->zeroed_cnt + pool->zero_pending;
+  if (cnt < ZERO_LOW)
+    pool->zero_refill = true;
+  else if (cnt >= ZERO_HIGH)
+    pool->zero_refill = false;
+  if (pool->zero_refill)
+    {
+      page_idx = alloc_pages (pool, 1);
+      if (page_idx != BITMAP_ERROR)
+        {
+          bitmap_mark (pool->used_map, page_idx);
+          pool->zero_pending++;
+        }
+      else
+        pool->zero_refill = false;
+    }
+  pool_unlock (pool);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  page = pool->base + PGSIZE * page_idx;
+  intr_enable ();
+  memset (page, 0, PGSIZE);
+  intr_disable ();
+
+  pool_lock (pool);
+  pool->zero_pending--;
+  pool->zeroed[pool->zeroed_cnt++] = page;
+  pool_unlock (pool);
+  cpu_current ()->zero_idle++;
+  return true;
+}
+
+/* Returns the list element kept at the start of free block
+   PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Adds the block of ORDER at PAGE_IDX to POOL's free blocks. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->orders[page_idx] = order;
+  list_push_front (&pool->free[order], block_elem (pool, page_idx));
+}
+
+/* Removes the free block at PAGE_IDX from POOL's free blocks. */
+static void
+remove_block (struct pool *pool, size_t page_idx)
+{
+  list_remove (block_elem (pool, page_idx));
+  pool->orders[page_idx] = NOT_FREE;
+}
+
+/* Removes PAGE_CNT contiguous pages from POOL's free blocks and
+   returns the index of the first, or BITMAP_ERROR if no free
+   block is big enough.  POOL's lock must be held. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t page_idx;
+  int order, k;
+
+  for (order = 0; order < ORDER_CNT; order++)
+    if (((size_t) 1 << order) >= page_cnt)
+      break;
+  for (k = order; k < ORDER_CNT; k++)
+    if (!list_empty (&pool->free[k]))
+      break;
+  if (k >= ORDER_CNT)
+    return BITMAP_ERROR;
+
+  e = list_front (&pool->free[k]);
+  page_idx = pg_no (e) - pg_no (pool->base);
+  remove_block (pool, page_idx);
+
+  /* Split the block, freeing upper halves, until it is of the
+     order that fits. */
+  while (k > order)
+    {
+      k--;
+      push_block (pool, page_idx + ((size_t) 1 << k), k);
+    }
+
+  /* Free the pages past the ones asked for. */
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Adds the PAGE_CNT pages starting at PAGE_IDX to POOL's free
+   blocks, as the fewest blocks that they can be divided into.
+   POOL's lock must be held, except at initialization. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Adds the block of ORDER at PAGE_IDX to POOL's free blocks,
+   merging it with its buddy for as long as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order + 1 < ORDER_CNT)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->orders[buddy] != order)
+        break;
+      remove_block (pool, buddy);
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Prints the free space in POOL, named NAME, including the
+   number of free blocks of each order that has any. */
+static void
+print_pool_stats (struct pool *pool, const char *name)
+{
+  size_t cnt[ORDER_CNT];
+  size_t free_cnt = 0;
+  enum intr_level old_level;
+  int order, largest = -1;
+
+  old_level = intr_disable ();
+  pool_lock (pool);
+  for (order = 0; order < ORDER_CNT; order++)
+    {
+      cnt[order] = list_size (&pool->free[order]);
+      free_cnt += cnt[order] << order;
+      if (cnt[order] > 0)
+        largest = order;
+    }
+  pool_unlock (pool);
+  intr_set_level (old_level);
+
+  printf ("%s: %zu of %zu pages free, largest block %zu pages\n",
+          name, free_cnt, pool->page_cnt,
+          largest >= 0 ? (size_t) 1 << largest : 0);
+  printf ("%s: free blocks by order:", name);
+  for (order = 0; order < ORDER_CNT; order++)
+    if (cnt[order] > 0)
+      printf (" %d:%zu", order, cnt[order]);
+  printf ("\n");
+}
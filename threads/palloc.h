@@ -1,7 +1,9 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include "threads/spinlock.h"
 
 /* How to allocate pages. */
 enum palloc_flags
@@ -11,10 +13,25 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Number of free pages that a CPU can cache from each pool. */
+#define PALLOC_MAG_SIZE 16
+
+/* A CPU's cache of free pages from one pool, its "magazine".
+   See palloc.c. */
+struct palloc_mag
+  {
+    struct spinlock lock;               /* Protects the members below. */
+    size_t cnt;                         /* Number of pages. */
+    void *pages[PALLOC_MAG_SIZE];       /* Pages, most recently freed last. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_idle (void);
+void palloc_print_stats (void);
+void palloc_print_pools (void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,231 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/pagedir.h"
+#endif
+
+/* Statistical sampling profiler.
+
+   On every timer interrupt, profile_sample() takes the
+   interrupted instruction pointer and the return addresses found
+   by following the chain of saved frame pointers, up to
+   PROFILE_DEPTH addresses in all.  Samples with the same thread,
+   mode (user or kernel), and call stack go into the same bucket
+   of a fixed-size hash table, which counts them.
+
+   At shutdown, profile_print_stats() prints each bucket as a
+   line in the "collapsed stack" format used by flame graph
+   tools, prefixed by "profile: ", with the thread and mode as the
+   two outermost frames:
+
+     profile: main (1);kernel;0xc0020c1d;0xc002a6f4 17
+
+   The addresses are raw.  "backtrace --profile" turns them into
+   function names, using kernel.o for the kernel and the user
+   programs' ELF binaries for user code. */
+
+bool profile_enabled;
+
+/* Maximum number of addresses in a sample. */
+#define PROFILE_DEPTH 16
+
+/* Number of pages in the table of buckets. */
+#define PROFILE_PAGES 32
+
+/* Number of buckets to try before dropping a sample. */
+#define PROFILE_PROBE_CNT 16
+
+/* Samples with one call stack. */
+struct profile_bucket
+  {
+    unsigned count;             /* Number of samples, 0 if unused. */
+    tid_t tid;                  /* Thread sampled. */
+    char name[16];              /* Thread's name. */
+    bool user;                  /* Sampled in user mode? */
+    int depth;                  /* Number of addresses in `pcs'. */
+    uintptr_t pcs[PROFILE_DEPTH]; /* Innermost address first. */
+  };
+
+#define BUCKET_CNT (PROFILE_PAGES * PGSIZE / sizeof (struct profile_bucket))
+
+static struct profile_bucket *buckets;  /* Hash table. */
+static struct spinlock profile_lock;    /* Protects the members above. */
+static long long sample_cnt;            /* Samples taken. */
+static long long drop_cnt;              /* Samples with no free bucket. */
+
+static int walk_kernel_stack (struct thread *, void **frame,
+                              uintptr_t *pcs, int depth);
+#ifdef USERPROG
+static int walk_user_stack (struct thread *, void **frame,
+                            uintptr_t *pcs, int depth);
+#endif
+
+/* Allocates the profiler's table, if "-profile" was given. */
+void
+profile_init (void)
+{
+  if (profile_enabled)
+    buckets = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, PROFILE_PAGES);
+}
+
+/* Records a sample of the code interrupted with frame F, which
+   must be the running thread's.  Called by the timer interrupt
+   handler. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  uintptr_t pcs[PROFILE_DEPTH];
+  bool user = (f->cs & 3) == 3;
+  unsigned hash;
+  int depth;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (buckets == NULL)
+    return;
+
+  pcs[0] = (uintptr_t) f->eip;
+  if (!user)
+    depth = walk_kernel_stack (t, (void **) f->ebp, pcs, 1);
+#ifdef USERPROG
+  else if (t->pagedir != NULL)
+    depth = walk_user_stack (t, (void **) f->ebp, pcs, 1);
+#endif
+  else
+    depth = 1;
+
+  hash = hash_bytes (pcs, depth * sizeof *pcs) ^ hash_int (t->tid * 2 + user);
+
+  spin_lock (&profile_lock);
+  sample_cnt++;
+  for (i = 0; i < PROFILE_PROBE_CNT; i++)
+    {
+      struct profile_bucket *b = &buckets[(hash + i) % BUCKET_CNT];
+
+      if (b->count == 0)
+        {
+          b->tid = t->tid;
+          strlcpy (b->name, t->name, sizeof b->name);
+          b->user = user;
+          b->depth = depth;
+          memcpy (b->pcs, pcs, depth * sizeof *pcs);
+        }
+      else if (b->tid != t->tid || b->user != user || b->depth != depth
+               || memcmp (b->pcs, pcs, depth * sizeof *pcs))
+        continue;
+      b->count++;
+      break;
+    }
+  if (i == PROFILE_PROBE_CNT)
+    drop_cnt++;
+  spin_unlock (&profile_lock);
+}
+
+/* Prints the samples in collapsed stack format.  The buckets in
+   use are copied under the lock and printed afterward, because
+   printing may sleep. */
+void
+profile_print_stats (void)
+{
+  struct profile_bucket *copy;
+  long long samples, drops;
+  enum intr_level old_level;
+  size_t i, cnt = 0;
+
+  if (buckets == NULL)
+    return;
+
+  copy = palloc_get_multiple (0, PROFILE_PAGES);
+  if (copy == NULL)
+    {
+      printf ("Profile: out of memory\n");
+      return;
+    }
+
+  old_level = intr_disable ();
+  spin_lock (&profile_lock);
+  samples = sample_cnt;
+  drops = drop_cnt;
+  for (i = 0; i < BUCKET_CNT; i++)
+    if (buckets[i].count != 0)
+      copy[cnt++] = buckets[i];
+  spin_unlock (&profile_lock);
+  intr_set_level (old_level);
+
+  printf ("Profile: %lld samples, %lld dropped.\n", samples, drops);
+  for (i = 0; i < cnt; i++)
+    {
+      struct profile_bucket *b = &copy[i];
+      int j;
+
+      printf ("profile: %s (%d);%s", b->name, b->tid,
+              b->user ? "user" : "kernel");
+      for (j = b->depth - 1; j >= 0; j--)
+        printf (";%#"PRIxPTR, b->pcs[j]);
+      printf (" %u\n", b->count);
+    }
+  palloc_free_multiple (copy, PROFILE_PAGES);
+}
+
+/* Appends to PCS, which already holds DEPTH addresses, the
+   return addresses in the chain of kernel stack frames that
+   starts at FRAME.  Returns the new number of addresses.  Only
+   frames on T's kernel stack, between struct thread and the end
+   of its page, are followed, and each must be above the one
+   before.  FRAME may come from a user-chosen %ebp, for a sample
+   taken in intr_entry before it sets up its own frame, so
+   anything else ends the walk without being read. */
+static int
+walk_kernel_stack (struct thread *t, void **frame, uintptr_t *pcs, int depth)
+{
+  while (depth < PROFILE_DEPTH
+         && pg_round_down (frame) == pg_round_down (t)
+         && (uint8_t *) frame >= (uint8_t *) (t + 1)
+         && pg_ofs (frame) <= PGSIZE - 2 * sizeof *frame
+         && (uintptr_t) frame % sizeof *frame == 0
+         && frame[1] != NULL)
+    {
+      void **next = frame[0];
+
+      pcs[depth++] = (uintptr_t) frame[1];
+      if (next <= frame)
+        break;
+      frame = next;
+    }
+  return depth;
+}
+
+#ifdef USERPROG
+/* Like walk_kernel_stack(), but for thread T's user stack.  A
+   frame is followed only if its page is mapped in T's page
+   directory, so that reading it cannot fault. */
+static int
+walk_user_stack (struct thread *t, void **frame, uintptr_t *pcs, int depth)
+{
+  while (depth < PROFILE_DEPTH
+         && is_user_vaddr (frame)
+         && pg_ofs (frame) <= PGSIZE - 2 * sizeof *frame
+         && (uintptr_t) frame % sizeof *frame == 0
+         && pagedir_get_page (t->pagedir, frame) != NULL
+         && frame[1] != NULL)
+    {
+      void **next = frame[0];
+
+      pcs[depth++] = (uintptr_t) frame[1];
+      if (next <= frame)
+        break;
+      frame = next;
+    }
+  return depth;
+}
+#endif
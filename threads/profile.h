@@ -0,0 +1,17 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* If false (default), the timer interrupt does not sample.
+   If true, set by kernel command-line option "-profile", each
+   timer interrupt records the call stack that it interrupted,
+   and the samples are printed at shutdown. */
+extern bool profile_enabled;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,415 @@
+#include "threads/schedgroup.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* The root group. */
+struct schedgroup root_group;
+
+/* All groups except the root group.  group_lock protects this
+   list, the `owner' and `ref_cnt' members of groups, and
+   next_id. */
+static struct list group_list;
+static struct spinlock group_lock;
+static int next_id = SCHEDGROUP_ROOT + 1;
+
+static void init_group (struct schedgroup *, int id);
+static struct schedgroup *lookup_group (int id);
+static void new_period (struct schedgroup *, int64_t now);
+static void unthrottle (struct schedgroup *, struct list *woken);
+static void wake_parked (struct list *);
+static timeout_func refill;
+static work_func free_group;
+
+/* Initializes the root group and the list of groups.  Called by
+   thread_init(). */
+void
+schedgroup_init (void)
+{
+  list_init (&group_list);
+  spinlock_init (&group_lock);
+  init_group (&root_group, SCHEDGROUP_ROOT);
+}
+
+/* Creates a new scheduling group, with the default weight and no
+   quota, owned by the running thread, which does not join it.
+   Returns the new group's identifier, or -1 if memory is not
+   available. */
+int
+schedgroup_create (void)
+{
+  struct schedgroup *g;
+  enum intr_level old_level;
+  int id;
+
+  g = malloc (sizeof *g);
+  if (g == NULL)
+    return -1;
+
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  id = next_id++;
+  init_group (g, id);
+  g->owner = thread_tid ();
+  g->ref_cnt = 1;
+  list_push_back (&group_list, &g->elem);
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+
+  return id;
+}
+
+/* Moves the running thread into the group with identifier ID.
+   Threads it creates afterward will also be in that group.
+   Returns false if there is no such group. */
+bool
+schedgroup_join (int id)
+{
+  struct schedgroup *g = lookup_group (id);
+
+  if (g == NULL)
+    return false;
+  schedgroup_put (thread_set_group (g));
+  return true;
+}
+
+/* Returns true if the running thread created the group with
+   identifier ID, which still exists.  A user process may
+   configure or join only the groups that it created, so that it
+   cannot re-weight, throttle, or join another process's groups.
+   Kernel threads are not restricted. */
+bool
+schedgroup_owned (int id)
+{
+  tid_t tid = thread_tid ();
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool owned = false;
+
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  for (e = list_begin (&group_list); e != list_end (&group_list);
+       e = list_next (e))
+    {
+      struct schedgroup *g = list_entry (e, struct schedgroup, elem);
+      if (g->id == id)
+        {
+          owned = g->owner == tid;
+          break;
+        }
+    }
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+
+  return owned;
+}
+
+/* Sets the weight and quota of the group with identifier ID to
+   those in PARAMS, and starts a new quota period.  A throttled
+   group is unthrottled.  Returns false if there is no such
+   group, if ID is the root group, or if PARAMS is invalid. */
+bool
+schedgroup_set (int id, const struct schedgroup_params *params)
+{
+  struct schedgroup *g;
+  enum intr_level old_level;
+  struct list woken;
+
+  if (params->weight < SCHEDGROUP_WEIGHT_MIN
+      || params->weight > SCHEDGROUP_WEIGHT_MAX
+      || params->quota < 0
+      || (params->quota > 0 && params->period <= 0)
+      || id == SCHEDGROUP_ROOT)
+    return false;
+  g = lookup_group (id);
+  if (g == NULL)
+    return false;
+
+  list_init (&woken);
+  old_level = intr_disable ();
+  spin_lock (&g->lock);
+  g->weight = params->weight;
+  g->quota = params->quota;
+  g->period = params->quota > 0 ? params->period : 0;
+  g->period_end = timer_ticks () + g->period;
+  g->used = 0;
+  if (g->throttled)
+    {
+      unthrottle (g, &woken);
+
+      /* If the refill is already running, it finds the group
+         unthrottled and drops its own reference. */
+      if (timeout_cancel (&g->refill))
+        schedgroup_put (g);
+    }
+  spin_unlock (&g->lock);
+  wake_parked (&woken);
+  intr_set_level (old_level);
+
+  schedgroup_put (g);
+  return true;
+}
+
+/* Takes a reference to group G. */
+void
+schedgroup_get (struct schedgroup *g)
+{
+  enum intr_level old_level;
+
+  if (g == &root_group)
+    return;
+
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  ASSERT (g->ref_cnt > 0);
+  g->ref_cnt++;
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+}
+
+/* Drops a reference to group G, which is freed once no
+   references remain.  May be called in any context. */
+void
+schedgroup_put (struct schedgroup *g)
+{
+  enum intr_level old_level;
+  bool dead;
+
+  if (g == &root_group)
+    return;
+
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  ASSERT (g->ref_cnt > 0);
+  dead = --g->ref_cnt == 0;
+  if (dead)
+    list_remove (&g->elem);
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+
+  /* free() may sleep, so leave it to a worker thread. */
+  if (dead)
+    work_queue (&g->free_work);
+}
+
+/* Drops the references held by the running thread, which is
+   exiting: its ownership of the groups it created and its
+   membership in its group.  The thread finishes exiting in the
+   root group, so that it does not outlive its group. */
+void
+schedgroup_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+  struct list dead;
+  enum intr_level old_level;
+
+  list_init (&dead);
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  for (e = list_begin (&group_list); e != list_end (&group_list); )
+    {
+      struct schedgroup *g = list_entry (e, struct schedgroup, elem);
+
+      e = list_next (e);
+      if (g->owner == t->tid)
+        {
+          g->owner = TID_ERROR;
+          if (--g->ref_cnt == 0)
+            {
+              list_remove (&g->elem);
+              list_push_back (&dead, &g->elem);
+            }
+        }
+    }
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+
+  /* Queueing work may yield, so do it without group_lock. */
+  while (!list_empty (&dead))
+    {
+      struct schedgroup *g = list_entry (list_pop_front (&dead),
+                                         struct schedgroup, elem);
+      work_queue (&g->free_work);
+    }
+
+  schedgroup_put (thread_set_group (&root_group));
+}
+
+/* Charges group G, whose member is running, for a timer tick.
+   Returns true if G is throttled, in which case the running
+   thread should yield.  Interrupts must be off. */
+bool
+schedgroup_charge (struct schedgroup *g)
+{
+  int64_t now;
+  bool throttled;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Most groups have no quota.  Check again with the lock
+     held, in case the quota is being changed. */
+  if (g->quota == 0)
+    return false;
+
+  now = timer_ticks ();
+  spin_lock (&g->lock);
+  if (g->quota > 0)
+    {
+      if (now >= g->period_end)
+        new_period (g, now);
+      if (!g->throttled && ++g->used >= g->quota)
+        {
+          g->throttled = true;
+          schedgroup_get (g);
+          timeout_add (&g->refill, g->period_end);
+        }
+    }
+  throttled = g->throttled;
+  spin_unlock (&g->lock);
+  return throttled;
+}
+
+/* If the group of thread T, which is being unblocked, is
+   throttled, adds T to the group's parked threads and returns
+   true.  Otherwise, returns false.  Interrupts must be off. */
+bool
+schedgroup_park (struct thread *t)
+{
+  struct schedgroup *g = t->group;
+  bool parked = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_BLOCKED);
+
+  if (!g->throttled)
+    return false;
+
+  spin_lock (&g->lock);
+  if (g->throttled)
+    {
+      list_push_back (&g->parked, &t->elem);
+      parked = true;
+    }
+  spin_unlock (&g->lock);
+  return parked;
+}
+
+/* Initializes G as a group with identifier ID, the default
+   weight, and no quota. */
+static void
+init_group (struct schedgroup *g, int id)
+{
+  g->id = id;
+  g->owner = TID_ERROR;
+  g->ref_cnt = 0;
+  g->weight = SCHEDGROUP_WEIGHT_DEFAULT;
+  spinlock_init (&g->lock);
+  g->quota = 0;
+  g->period = 0;
+  g->period_end = 0;
+  g->used = 0;
+  g->throttled = false;
+  list_init (&g->parked);
+  timeout_init (&g->refill, refill, g);
+  work_init (&g->free_work, free_group, g);
+  thread_init_group (g);
+}
+
+/* Returns the group with identifier ID, with a reference taken,
+   or a null pointer if there is none. */
+static struct schedgroup *
+lookup_group (int id)
+{
+  struct schedgroup *found = NULL;
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  if (id == SCHEDGROUP_ROOT)
+    return &root_group;
+
+  old_level = intr_disable ();
+  spin_lock (&group_lock);
+  for (e = list_begin (&group_list); e != list_end (&group_list);
+       e = list_next (e))
+    {
+      struct schedgroup *g = list_entry (e, struct schedgroup, elem);
+      if (g->id == id)
+        {
+          g->ref_cnt++;
+          found = g;
+          break;
+        }
+    }
+  spin_unlock (&group_lock);
+  intr_set_level (old_level);
+
+  return found;
+}
+
+/* Moves group G, whose period has ended by NOW, into the period
+   that contains NOW, with none of its quota used.  G's lock must
+   be held. */
+static void
+new_period (struct schedgroup *g, int64_t now)
+{
+  g->period_end += ((now - g->period_end) / g->period + 1) * g->period;
+  g->used = 0;
+}
+
+/* Clears throttled group G's throttled flag and moves its parked
+   threads to WOKEN.  G's lock must be held. */
+static void
+unthrottle (struct schedgroup *g, struct list *woken)
+{
+  ASSERT (g->throttled);
+
+  g->throttled = false;
+  while (!list_empty (&g->parked))
+    list_push_back (woken, list_pop_front (&g->parked));
+}
+
+/* Unblocks the parked threads in list WOKEN. */
+static void
+wake_parked (struct list *woken)
+{
+  while (!list_empty (woken))
+    thread_unblock (list_entry (list_pop_front (woken),
+                                struct thread, elem));
+}
+
+/* Timeout function that ends the throttling of group G_ at the
+   end of its period. */
+static void
+refill (void *g_)
+{
+  struct schedgroup *g = g_;
+  enum intr_level old_level;
+  struct list woken;
+  int64_t now = timer_ticks ();
+
+  list_init (&woken);
+  old_level = intr_disable ();
+  spin_lock (&g->lock);
+  if (g->throttled)
+    {
+      if (now >= g->period_end)
+        new_period (g, now);
+      unthrottle (g, &woken);
+    }
+  spin_unlock (&g->lock);
+  wake_parked (&woken);
+  intr_set_level (old_level);
+
+  schedgroup_put (g);
+}
+
+/* Work function that frees group G_, which has no references
+   left. */
+static void
+free_group (void *g_)
+{
+  free (g_);
+}
@@ -0,0 +1,89 @@
+#ifndef THREADS_SCHEDGROUP_H
+#define THREADS_SCHEDGROUP_H
+
+#include <list.h>
+#include <rbtree.h>
+#include <schedgroup.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/cpu.h"
+#include "threads/spinlock.h"
+#include "threads/workqueue.h"
+#include "devices/timeout.h"
+
+/* Scheduling groups.
+
+   Every thread belongs to one scheduling group, initially that
+   of the thread that created it, so that a process and all of
+   its descendants share a group unless one of them joins
+   another.  Threads start out in the root group, which is never
+   throttled and cannot be configured.  See lib/schedgroup.h for
+   what a group's weight and quota mean.
+
+   A group lives as long as the thread that created it or any of
+   its members, whichever is longer.
+
+   When a group uses up its quota, it is throttled until the end
+   of the period.  A running member yields at its next timer
+   tick.  A member that is unblocked, or that is picked to run
+   from a run queue, is instead parked on the group's `parked'
+   list, in THREAD_BLOCKED state.  At the end of the period, the
+   group's parked threads are unblocked all together. */
+
+/* A scheduling group's part of one CPU's run queue, under the
+   completely fair scheduler.  The run queue's tree holds the
+   group_rqs that have threads in them, by the group's virtual
+   runtime on that CPU, and each group_rq holds its threads by
+   their own virtual runtimes.  Owned by thread.c and protected
+   by the lock of the run queue. */
+struct group_rq
+  {
+    struct rbtree tree;                 /* Ready threads by virtual runtime. */
+    int64_t min_vruntime;               /* Floor of the threads' runtimes. */
+    size_t cnt;                         /* Number of threads in tree. */
+    int64_t vruntime;                   /* Group's virtual runtime. */
+    struct rb_elem elem;                /* Element in run queue's tree. */
+  };
+
+/* A scheduling group. */
+struct schedgroup
+  {
+    int id;                             /* Group identifier. */
+    tid_t owner;                        /* Creator, or TID_ERROR once it exits. */
+    int ref_cnt;                        /* Members, creator, and refill. */
+    struct list_elem elem;              /* Element in list of all groups. */
+    unsigned weight;                    /* Weight under the CFS. */
+
+    struct spinlock lock;               /* Protects the members below. */
+    int quota;                          /* Ticks per period, or 0. */
+    int period;                         /* Period in ticks. */
+    int64_t period_end;                 /* Tick at which this period ends. */
+    int used;                           /* Ticks used in this period. */
+    bool throttled;                     /* Out of quota until period_end? */
+    struct list parked;                 /* Members parked while throttled. */
+    struct timeout refill;              /* Ends throttling at period_end. */
+
+    struct work free_work;              /* Frees the group. */
+    struct group_rq rqs[CPU_MAX];       /* Part of each CPU's run queue. */
+  };
+
+/* Identifier of the root group. */
+#define SCHEDGROUP_ROOT 0
+
+extern struct schedgroup root_group;
+
+void schedgroup_init (void);
+
+int schedgroup_create (void);
+bool schedgroup_join (int id);
+bool schedgroup_set (int id, const struct schedgroup_params *);
+bool schedgroup_owned (int id);
+
+/* For use by threads/thread.c. */
+void schedgroup_get (struct schedgroup *);
+void schedgroup_put (struct schedgroup *);
+void schedgroup_exit (void);
+bool schedgroup_charge (struct schedgroup *);
+bool schedgroup_park (struct thread *);
+
+#endif /* threads/schedgroup.h */
@@ -0,0 +1,83 @@
+#include "threads/softirq.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Number of times softirq_run() goes back for softirqs raised
+   while it ran, before leaving them for later.  Bounds the time
+   that an interrupted thread can be kept from running by a
+   steady stream of interrupts. */
+#define SOFTIRQ_RESTART_MAX 10
+
+/* Handler for each softirq type. */
+static softirq_func *handlers[SOFTIRQ_CNT];
+
+/* Registers FUNC to handle softirqs of the given TYPE. */
+void
+softirq_register (enum softirq_type type, softirq_func *func)
+{
+  ASSERT (type < SOFTIRQ_CNT);
+  ASSERT (handlers[type] == NULL);
+
+  handlers[type] = func;
+}
+
+/* Marks a softirq of the given TYPE pending on the current CPU.
+   It runs when the current external interrupt, or the next one
+   on this CPU, returns, or else when the CPU next goes idle.
+   May be called in any context. */
+void
+softirq_raise (enum softirq_type type)
+{
+  enum intr_level old_level;
+
+  ASSERT (type < SOFTIRQ_CNT);
+  ASSERT (handlers[type] != NULL);
+
+  old_level = intr_disable ();
+  cpu_current ()->softirq_pending |= 1u << type;
+  intr_set_level (old_level);
+}
+
+/* Returns true if any softirq is pending on the current CPU.
+   Interrupts must be off. */
+bool
+softirq_pending (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return cpu_current ()->softirq_pending != 0;
+}
+
+/* Runs the softirqs pending on the current CPU, if any, with
+   interrupts on.  Called with interrupts off, by intr_handler()
+   after acknowledging an external interrupt and by the idle
+   thread, and returns with interrupts off.  May not be called
+   while softirqs are already running on this CPU. */
+void
+softirq_run (void)
+{
+  struct cpu *c = cpu_current ();
+  int restart = SOFTIRQ_RESTART_MAX;
+  uint32_t pending;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!c->in_softirq);
+
+  /* While in_softirq is set, intr_handler() does not yield, so
+     this thread stays on this CPU until we are done. */
+  c->in_softirq = true;
+  while ((pending = c->softirq_pending) != 0 && restart-- > 0)
+    {
+      enum softirq_type type;
+
+      c->softirq_pending = 0;
+      intr_enable ();
+      for (type = 0; type < SOFTIRQ_CNT; type++)
+        if (pending & (1u << type))
+          handlers[type] ();
+      intr_disable ();
+    }
+  c->in_softirq = false;
+}
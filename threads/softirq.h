@@ -0,0 +1,36 @@
+#ifndef THREADS_SOFTIRQ_H
+#define THREADS_SOFTIRQ_H
+
+#include <stdbool.h>
+
+/* Softirqs: work deferred from external interrupt handlers.
+
+   An interrupt handler that has more to do than acknowledge its
+   device raises a softirq with softirq_raise(), and the softirq's
+   handler runs on the same CPU once the interrupt has been
+   acknowledged, with interrupts turned back on.  Raising a
+   softirq that is already pending has no further effect, so a
+   handler must find all of its work, not just one item.
+
+   Like an external interrupt handler, a softirq handler runs in
+   interrupt context (intr_context() returns true), so it may not
+   sleep, and it may ask to yield with intr_yield_on_return().
+   Interrupts arriving while it runs are handled, but they do not
+   yield or run softirqs themselves. */
+
+/* Kinds of softirqs, in the order they run. */
+enum softirq_type
+  {
+    SOFTIRQ_TIMER,              /* Timeouts, hrtimers, MLFQS. */
+    SOFTIRQ_BLOCK,              /* Block device completions. */
+    SOFTIRQ_CNT                 /* Number of softirq types. */
+  };
+
+typedef void softirq_func (void);
+
+void softirq_register (enum softirq_type, softirq_func *);
+void softirq_raise (enum softirq_type);
+bool softirq_pending (void);
+void softirq_run (void);
+
+#endif /* threads/softirq.h */
@@ -0,0 +1,74 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Spin lock.
+
+   On a uniprocessor, turning interrupts off is enough to make a
+   critical section atomic, because nothing else can run on the
+   CPU until they are turned back on.  With more than one CPU
+   running, the other CPUs keep going, so data that they may also
+   touch needs a spin lock as well.
+
+   A spin lock may only be acquired with interrupts off, and must
+   be released before interrupts are turned back on.  Otherwise
+   an interrupt handler on the same CPU could try to acquire the
+   lock that it interrupted and spin forever.  A thread must not
+   sleep while holding a spin lock.
+
+   A spin lock whose memory is all zeros is unlocked, so static
+   spin locks need no initialization. */
+struct spinlock
+  {
+    volatile int locked;        /* Nonzero if held. */
+  };
+
+/* Initializes spin lock L as unlocked. */
+static inline void
+spinlock_init (struct spinlock *l)
+{
+  l->locked = 0;
+}
+
+/* Tries to acquire spin lock L, without spinning.  Returns true
+   if successful, false if it is held. */
+static inline bool
+spin_trylock (struct spinlock *l)
+{
+  int old = 1;
+
+  /* XCHG with a memory operand is implicitly locked, and it is
+     also a full memory barrier.  See [IA32-v2b] "XCHG". */
+  asm volatile ("xchgl %0, %1" : "+r" (old), "+m" (l->locked) : : "memory");
+  return old == 0;
+}
+
+/* Acquires spin lock L, spinning until it is available.
+   Interrupts must be off. */
+static inline void
+spin_lock (struct spinlock *l)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!spin_trylock (l))
+    while (l->locked)
+      asm volatile ("pause");
+}
+
+/* Releases spin lock L, which must be held. */
+static inline void
+spin_unlock (struct spinlock *l)
+{
+  ASSERT (l->locked);
+
+  /* Stores are not reordered with older loads or stores on x86,
+     so only the compiler must be kept from sinking the critical
+     section below the release. */
+  asm volatile ("" : : : "memory");
+  l->locked = 0;
+}
+
+#endif /* threads/spinlock.h */
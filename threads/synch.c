@@ -27,10 +27,21 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+static heap_less_func thread_priority_less;
+static heap_less_func waiter_priority_less;
+static void wait_unpinned (struct thread *);
+static void lock_take (struct lock *);
+static bool rwlock_try_read (struct rwlock *);
+static bool rwlock_try_write (struct rwlock *);
+static void rwlock_spin (struct rwlock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +58,8 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, thread_priority_less, NULL);
+  spinlock_init (&sema->lock);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -60,19 +72,24 @@ sema_init (struct semaphore *sema, unsigned value)
 void
 sema_down (struct semaphore *sema)
 {
+  struct thread *cur = thread_current ();
   enum intr_level old_level;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  spin_lock (&sema->lock);
   while (sema->value == 0)
     {
-      list_insert_ordered (&sema->waiters, &thread_current ()->elem,
-                           cmp_priority, NULL);
-      thread_block ();
+      cur->wait_sema = sema;
+      heap_push (&sema->waiters, &cur->wait_elem);
+      thread_block_unlock (&sema->lock);
+      wait_unpinned (cur);
+      spin_lock (&sema->lock);
     }
   sema->value--;
+  spin_unlock (&sema->lock);
   intr_set_level (old_level);
 }
 
@@ -90,6 +107,7 @@ sema_try_down (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
+  spin_lock (&sema->lock);
   if (sema->value > 0)
     {
       sema->value--;
@@ -97,6 +115,7 @@ sema_try_down (struct semaphore *sema)
     }
   else
     success = false;
+  spin_unlock (&sema->lock);
   intr_set_level (old_level);
 
   return success;
@@ -114,13 +133,16 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
-  {
-    list_sort (&sema->waiters, cmp_priority, NULL);
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
-  }
+  spin_lock (&sema->lock);
+  if (!heap_empty (&sema->waiters))
+    {
+      struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                     struct thread, wait_elem);
+      t->wait_sema = NULL;
+      thread_unblock (t);
+    }
   sema->value++;
+  spin_unlock (&sema->lock);
 
   intr_set_level (old_level);
 
@@ -179,14 +201,24 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   NAME identifies the lock in the statistics printed at
+   shutdown when the kernel is built with LOCKSTAT defined.  All
+   of the locks with the same NAME share one set of statistics,
+   so NAME should be a string constant or otherwise outlive the
+   lock. */
 void
-lock_init (struct lock *lock)
+lock_init (struct lock *lock, const char *name UNUSED)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
+  lock->priority = PRI_MIN;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCKSTAT
+  lock->stat = lockstat_get (name);
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -200,24 +232,57 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  struct semaphore *sema = &lock->semaphore;
+  enum intr_level old_level;
+#ifdef LOCKSTAT
+  uint64_t start = rdtsc ();
+  bool contended = false;
+#endif
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  if (!thread_mlfqs && lock->holder != NULL)
-  {
-    if (list_size (&lock->holder->donations) < 8)
+  /* This is sema_down() with donation folded in.  Holding
+     donation_lock from the donation until we are among the
+     semaphore's waiters means that a thread that takes the lock
+     in between always finds our priority at the top of them.  A
+     thread that is woken but then loses the lock to another
+     donates again to the new holder. */
+  old_level = intr_disable ();
+  spin_lock (&donation_lock);
+  spin_lock (&sema->lock);
+  while (sema->value == 0)
     {
-      thread_current ()->wait_on_lock = lock;
-      list_push_back (&lock->holder->donations, &thread_current ()->donation_elem);
-      donate_priority ();
+#ifdef LOCKSTAT
+      contended = true;
+#endif
+      trace_record (TRACE_LOCK_CONTEND, (uint32_t) lock);
+      if (!thread_mlfqs)
+        {
+          cur->wait_on_lock = lock;
+          donate_priority ();
+        }
+      cur->wait_sema = sema;
+      heap_push (&sema->waiters, &cur->wait_elem);
+      spin_unlock (&donation_lock);
+      thread_block_unlock (&sema->lock);
+      wait_unpinned (cur);
+      spin_lock (&donation_lock);
+      spin_lock (&sema->lock);
     }
-  }
+  sema->value--;
+  lock_take (lock);
+  spin_unlock (&sema->lock);
+  cur->wait_on_lock = NULL;
+  spin_unlock (&donation_lock);
+  intr_set_level (old_level);
 
-  sema_down (&lock->semaphore);
-  if (!thread_mlfqs)
-    thread_current ()->wait_on_lock = NULL;
-  lock->holder = thread_current ();
+#ifdef LOCKSTAT
+  lock->acquire_time = rdtsc ();
+  lockstat_acquired (lock->stat, contended, lock->acquire_time - start);
+#endif
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -229,14 +294,33 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  struct semaphore *sema = &lock->semaphore;
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
-  success = sema_try_down (&lock->semaphore);
+  old_level = intr_disable ();
+  spin_lock (&donation_lock);
+  spin_lock (&sema->lock);
+  success = sema->value > 0;
+  if (success)
+    {
+      sema->value--;
+      lock_take (lock);
+    }
+  spin_unlock (&sema->lock);
+  spin_unlock (&donation_lock);
+  intr_set_level (old_level);
+
+#ifdef LOCKSTAT
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->acquire_time = rdtsc ();
+      lockstat_acquired (lock->stat, false, 0);
+    }
+#endif
   return success;
 }
 
@@ -248,16 +332,25 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock)
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+#ifdef LOCKSTAT
+  lockstat_released (lock->stat, rdtsc () - lock->acquire_time);
+#endif
+  old_level = intr_disable ();
+  spin_lock (&donation_lock);
   lock->holder = NULL;
   /* mlfqs 스케줄러 활성화시 priority donation 관련 코드 비활성화 */
   if (!thread_mlfqs)
   {
-    remove_with_lock (lock);
+    heap_remove (&thread_current ()->held_locks, &lock->elem);
     refresh_priority ();
   }
+  spin_unlock (&donation_lock);
+  intr_set_level (old_level);
 
   sema_up (&lock->semaphore);
 }
@@ -273,11 +366,12 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's waiters. */
 struct semaphore_elem
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -288,7 +382,8 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, waiter_priority_less, NULL);
+  spinlock_init (&cond->lock);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -314,7 +409,9 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock)
 {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -322,10 +419,18 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
-  list_insert_ordered (&cond->waiters, &waiter.elem,
-                       cmp_sem_priority, NULL);
+  waiter.thread = cur;
+  old_level = intr_disable ();
+  spin_lock (&cond->lock);
+  cur->wait_cond = cond;
+  cur->wait_cond_elem = &waiter.elem;
+  heap_push (&cond->waiters, &waiter.elem);
+  spin_unlock (&cond->lock);
+  intr_set_level (old_level);
+
   lock_release (lock);
   sema_down (&waiter.semaphore);
+  wait_unpinned (cur);
   lock_acquire (lock);
 }
 
@@ -339,17 +444,27 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED)
 {
+  struct semaphore_elem *waiter = NULL;
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters))
-  {
-    list_sort (&cond->waiters, cmp_sem_priority, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
-  }
+  old_level = intr_disable ();
+  spin_lock (&cond->lock);
+  if (!heap_empty (&cond->waiters))
+    {
+      waiter = heap_entry (heap_pop (&cond->waiters),
+                           struct semaphore_elem, elem);
+      waiter->thread->wait_cond = NULL;
+    }
+  spin_unlock (&cond->lock);
+  intr_set_level (old_level);
+
+  if (waiter != NULL)
+    sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -364,20 +479,537 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
 
+/* Initializes RW.  A readers-writer lock may be held either by
+   any number of readers at once or by a single writer, and is
+   meant for data that is read much more often than it is
+   changed, such as the file system.
+
+   Writers are preferred: once a writer is waiting, new readers
+   wait behind it, so a steady stream of readers cannot starve
+   writers.  When the lock is released, ownership is handed
+   directly to the waiters that it wakes, the highest-priority
+   writer if there is one and otherwise every waiting reader, so
+   a woken thread never has to compete for the lock again.
+   Waiters are kept in semaphores, so they are woken in priority
+   order.  Unlike a lock, a readers-writer lock does not donate
+   priority to its holders.
+
+   An acquire first tries to take RW without sleeping.  If that
+   fails because a writer that is running on another CPU holds
+   RW, it spins briefly in the hope that the writer releases it
+   soon, since that is cheaper than a trip through the
+   scheduler.
+
+   NAME is used as in lock_init().  Only writers count toward the
+   hold times in the statistics. */
+void
+rwlock_init (struct rwlock *rw, const char *name UNUSED)
+{
+  ASSERT (rw != NULL);
+
+  spinlock_init (&rw->lock);
+  rw->readers = 0;
+  rw->writing = false;
+  rw->writer = NULL;
+  rw->readers_waiting = 0;
+  rw->writers_waiting = 0;
+  sema_init (&rw->read_sema, 0);
+  sema_init (&rw->write_sema, 0);
+#ifdef LOCKSTAT
+  rw->stat = lockstat_get (name);
+#endif
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   is waiting for it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+#ifdef LOCKSTAT
+  uint64_t start = rdtsc ();
+#endif
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  if (rwlock_try_read (rw))
+    return;
+  rwlock_spin (rw);
+
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  success = !rw->writing && rw->writers_waiting == 0;
+  if (success)
+    rw->readers++;
+  else
+    rw->readers_waiting++;
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+  /* The releasing thread counts us as a reader before it wakes
+     us up. */
+  if (!success)
+    {
+      trace_record (TRACE_LOCK_CONTEND, (uint32_t) rw);
+      sema_down (&rw->read_sema);
+    }
+#ifdef LOCKSTAT
+  lockstat_acquired (rw->stat, !success, rdtsc () - start);
+#endif
+}
+
+/* Tries to acquire RW for reading and returns true if
+   successful or false on failure.
+
+   This function will not sleep, so it may be called within an
+   interrupt handler. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rwlock_try_read (rw);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   If we are the last reader, hands RW to a waiting writer, if
+   any. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool wake_writer = false;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->writers_waiting > 0)
+    {
+      rw->writers_waiting--;
+      rw->writing = true;
+      wake_writer = true;
+    }
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+  if (wake_writer)
+    sema_up (&rw->write_sema);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it if necessary.  RW must not already be held by the current
+   thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+#ifdef LOCKSTAT
+  uint64_t start = rdtsc ();
+#endif
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  if (rwlock_try_write (rw))
+    return;
+  rwlock_spin (rw);
+
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  success = !rw->writing && rw->readers == 0;
+  if (success)
+    rw->writing = true;
+  else
+    rw->writers_waiting++;
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+  /* The releasing thread marks RW as written before it wakes
+     us up. */
+  if (!success)
+    {
+      trace_record (TRACE_LOCK_CONTEND, (uint32_t) rw);
+      sema_down (&rw->write_sema);
+    }
+  rw->writer = thread_current ();
+#ifdef LOCKSTAT
+  rw->acquire_time = rdtsc ();
+  lockstat_acquired (rw->stat, !success, rw->acquire_time - start);
+#endif
+}
+
+/* Tries to acquire RW for writing and returns true if
+   successful or false on failure.  RW must not already be held
+   by the current thread.
+
+   This function will not sleep, so it may be called within an
+   interrupt handler. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  return rwlock_try_write (rw);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Hands RW to the highest-priority waiting writer, if any, or
+   otherwise to all of the waiting readers. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  unsigned wake_readers = 0;
+  bool wake_writer = false;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+#ifdef LOCKSTAT
+  lockstat_released (rw->stat, rdtsc () - rw->acquire_time);
+#endif
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  rw->writer = NULL;
+  if (rw->writers_waiting > 0)
+    {
+      rw->writers_waiting--;
+      wake_writer = true;
+    }
+  else
+    {
+      rw->writing = false;
+      rw->readers += rw->readers_waiting;
+      wake_readers = rw->readers_waiting;
+      rw->readers_waiting = 0;
+    }
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+  if (wake_writer)
+    sema_up (&rw->write_sema);
+  while (wake_readers-- > 0)
+    sema_up (&rw->read_sema);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise.  (Readers are not tracked.) */
 bool
-cmp_sem_priority (const struct list_elem *a,
-                  const struct list_elem *b, void *aux UNUSED)
+rwlock_held_by_current_thread (const struct rwlock *rw)
 {
-  struct semaphore_elem *sa = list_entry (a, struct semaphore_elem, elem);
-  struct semaphore_elem *sb = list_entry (b, struct semaphore_elem, elem);
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Takes RW for reading if no writer holds it or is waiting for
+   it, without sleeping.  Returns true if successful. */
+static bool
+rwlock_try_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  success = !rw->writing && rw->writers_waiting == 0;
+  if (success)
+    rw->readers++;
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+#ifdef LOCKSTAT
+  if (success)
+    lockstat_acquired (rw->stat, false, 0);
+#endif
+  return success;
+}
+
+/* Takes RW for writing if no thread holds it, without
+   sleeping.  Returns true if successful. */
+static bool
+rwlock_try_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  old_level = intr_disable ();
+  spin_lock (&rw->lock);
+  success = !rw->writing && rw->readers == 0;
+  if (success)
+    {
+      rw->writing = true;
+      rw->writer = thread_current ();
+    }
+  spin_unlock (&rw->lock);
+  intr_set_level (old_level);
+
+#ifdef LOCKSTAT
+  if (success)
+    {
+      rw->acquire_time = rdtsc ();
+      lockstat_acquired (rw->stat, false, 0);
+    }
+#endif
+  return success;
+}
+
+/* Maximum number of times to check a running writer in
+   rwlock_spin(). */
+#define RWLOCK_SPIN_CNT 1000
+
+/* Spins while RW is held by a writer that is running on another
+   CPU, for at most RWLOCK_SPIN_CNT checks.  Reading `writer'
+   without RW's lock is racy, but a thread's page is never
+   unmapped, so the worst a stale pointer can do is end the spin
+   early or late. */
+static void
+rwlock_spin (struct rwlock *rw)
+{
+  struct thread *writer;
+  int i;
+
+  if (cpu_cnt == 1)
+    return;
+
+  writer = rw->writer;
+  for (i = 0; i < RWLOCK_SPIN_CNT; i++)
+    {
+      barrier ();
+      if (writer == NULL || rw->writer != writer
+          || writer->status != THREAD_RUNNING)
+        break;
+      asm volatile ("pause");
+    }
+}
 
-  if ( list_entry (list_begin (&sa->semaphore.waiters), struct thread, elem)->priority >
-       list_entry (list_begin (&sb->semaphore.waiters), struct thread, elem)->priority )
-    return true;
-  return false;
+#ifdef LOCKSTAT
+/* Maximum number of distinct lock names. */
+#define LOCKSTAT_CNT 64
+
+/* Statistics for each lock name, in order of first use.  Locks
+   with names beyond the first LOCKSTAT_CNT share the last
+   entry. */
+static struct lockstat lockstats[LOCKSTAT_CNT];
+static size_t lockstat_cnt;
+static struct spinlock lockstats_lock;
+
+/* Returns the statistics for locks named NAME, creating them if
+   this is the first such lock. */
+struct lockstat *
+lockstat_get (const char *name)
+{
+  struct lockstat *ls = NULL;
+  enum intr_level old_level;
+  size_t i;
+
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&lockstats_lock);
+  for (i = 0; i < lockstat_cnt; i++)
+    if (!strcmp (lockstats[i].name, name))
+      {
+        ls = &lockstats[i];
+        break;
+      }
+  if (ls == NULL)
+    {
+      if (lockstat_cnt < LOCKSTAT_CNT - 1)
+        ls = &lockstats[lockstat_cnt++];
+      else
+        {
+          ls = &lockstats[LOCKSTAT_CNT - 1];
+          lockstat_cnt = LOCKSTAT_CNT;
+          name = "(other)";
+        }
+      if (ls->name == NULL)
+        ls->name = name;
+    }
+  spin_unlock (&lockstats_lock);
+  intr_set_level (old_level);
+
+  return ls;
+}
+
+/* Records an acquisition of a lock whose statistics are LS,
+   after waiting for WAIT cycles.  CONTENDED is true if the lock
+   was not available right away. */
+void
+lockstat_acquired (struct lockstat *ls, bool contended, uint64_t wait)
+{
+  enum intr_level old_level = intr_disable ();
+
+  spin_lock (&ls->lock);
+  ls->acquire_cnt++;
+  if (contended)
+    ls->contend_cnt++;
+  ls->wait_total += wait;
+  if (wait > ls->wait_max)
+    ls->wait_max = wait;
+  spin_unlock (&ls->lock);
+  intr_set_level (old_level);
+}
+
+/* Records the release of a lock whose statistics are LS, after
+   holding it for HOLD cycles. */
+void
+lockstat_released (struct lockstat *ls, uint64_t hold)
+{
+  enum intr_level old_level = intr_disable ();
+
+  spin_lock (&ls->lock);
+  ls->hold_total += hold;
+  if (hold > ls->hold_max)
+    ls->hold_max = hold;
+  spin_unlock (&ls->lock);
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of every lock name that was acquired at
+   least once. */
+void
+lockstat_print_stats (void)
+{
+  size_t i;
+
+  printf ("Lock statistics (times in cycles):\n");
+  printf ("%-16s %10s %10s %14s %12s %14s %12s\n", "name", "acquired",
+          "contended", "wait total", "wait max", "hold total", "hold max");
+  for (i = 0; i < lockstat_cnt; i++)
+    {
+      struct lockstat *ls = &lockstats[i];
+
+      if (ls->acquire_cnt == 0)
+        continue;
+      printf ("%-16s %10"PRIu64" %10"PRIu64" %14"PRIu64" %12"PRIu64
+              " %14"PRIu64" %12"PRIu64"\n",
+              ls->name, ls->acquire_cnt, ls->contend_cnt,
+              ls->wait_total, ls->wait_max, ls->hold_total, ls->hold_max);
+    }
+}
+#endif /* LOCKSTAT */
+
+/* Moves thread T within the waiters of the semaphore and the
+   condition variable that it is waiting on, if any, after its
+   priority has changed.  RAISED is true if the priority went
+   up, which takes constant time.  Interrupts must be off.
+
+   Once T is woken up, it may return from sema_down() or
+   cond_wait() and free the semaphore or condition variable, so
+   T is kept from returning by incrementing its `wait_pins'
+   until we are done.  The locked increment is a full memory
+   barrier, so either we see that sema_up() or cond_signal()
+   cleared T's wait_sema or wait_cond, or T sees its pin. */
+void
+synch_reprioritize (struct thread *t, bool raised)
+{
+  struct semaphore *sema;
+  struct condition *cond;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  asm volatile ("lock incl %0" : "+m" (t->wait_pins) : : "memory");
+
+  sema = t->wait_sema;
+  if (sema != NULL)
+    {
+      spin_lock (&sema->lock);
+      if (t->wait_sema == sema)
+        {
+          if (raised)
+            heap_increase (&sema->waiters, &t->wait_elem);
+          else
+            heap_update (&sema->waiters, &t->wait_elem);
+        }
+      spin_unlock (&sema->lock);
+    }
+
+  cond = t->wait_cond;
+  if (cond != NULL)
+    {
+      spin_lock (&cond->lock);
+      if (t->wait_cond == cond)
+        {
+          if (raised)
+            heap_increase (&cond->waiters, t->wait_cond_elem);
+          else
+            heap_update (&cond->waiters, t->wait_cond_elem);
+        }
+      spin_unlock (&cond->lock);
+    }
+
+  asm volatile ("lock decl %0" : "+m" (t->wait_pins) : : "memory");
+}
+
+/* Makes the running thread the holder of LOCK, whose semaphore
+   it has just downed.  The lock starts out with the priority of
+   its highest-priority waiter, and the running thread inherits
+   that priority if it is higher than its own.  Must be called
+   with donation_lock and the semaphore's lock held. */
+static void
+lock_take (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  lock->holder = cur;
+  if (thread_mlfqs)
+    return;
+
+  if (heap_empty (waiters))
+    lock->priority = PRI_MIN;
+  else
+    lock->priority = heap_entry (heap_top (waiters),
+                                 struct thread, wait_elem)->priority;
+  heap_push (&cur->held_locks, &lock->elem);
+  if (cur->priority < lock->priority)
+    cur->priority = lock->priority;
+}
+
+/* Waits until no other CPU is moving T, the running thread,
+   within a semaphore's or condition variable's waiters.  See
+   synch_reprioritize(). */
+static void
+wait_unpinned (struct thread *t)
+{
+  while (t->wait_pins != 0)
+    asm volatile ("pause");
+}
+
+/* Orders threads in a semaphore's waiters by priority. */
+static bool
+thread_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+                      void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, wait_elem)->priority
+          < heap_entry (b, struct thread, wait_elem)->priority);
+}
+
+/* Orders a condition variable's waiters by the priorities of
+   their threads. */
+static bool
+waiter_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+                      void *aux UNUSED)
+{
+  return (heap_entry (a, struct semaphore_elem, elem)->thread->priority
+          < heap_entry (b, struct semaphore_elem, elem)->thread->priority);
 }
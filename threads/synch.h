@@ -1,14 +1,19 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
-#include <list.h>
+#include <heap.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    struct spinlock lock;       /* Protects the members above. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -17,14 +22,45 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+#ifdef LOCKSTAT
+/* Contention statistics, shared by all the locks and
+   readers-writer locks given the same name.  Times are in
+   clock cycles. */
+struct lockstat
+  {
+    const char *name;           /* Name passed to lock_init(). */
+    struct spinlock lock;       /* Protects the members below. */
+    uint64_t acquire_cnt;       /* Number of acquisitions. */
+    uint64_t contend_cnt;       /* Acquisitions that had to wait. */
+    uint64_t wait_total;        /* Total time spent waiting. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_total;        /* Total time held. */
+    uint64_t hold_max;          /* Longest hold. */
+  };
+
+/* For locks of other kinds, such as spin locks, that want to be
+   counted too. */
+struct lockstat *lockstat_get (const char *name);
+void lockstat_acquired (struct lockstat *, bool contended, uint64_t wait);
+void lockstat_released (struct lockstat *, uint64_t hold);
+
+void lockstat_print_stats (void);
+#endif
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    int priority;               /* Highest priority donated through us. */
+    struct heap_elem elem;      /* Element in holder's `held_locks'. */
+#ifdef LOCKSTAT
+    struct lockstat *stat;      /* Statistics for our name. */
+    uint64_t acquire_time;      /* When `holder' acquired us. */
+#endif
   };
 
-void lock_init (struct lock *);
+void lock_init (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -33,7 +69,8 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    struct spinlock lock;       /* Protects `waiters'. */
   };
 
 void cond_init (struct condition *);
@@ -41,7 +78,33 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-bool cmp_sem_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct spinlock lock;       /* Protects the members below. */
+    unsigned readers;           /* Number of readers holding us. */
+    bool writing;               /* Held by a writer? */
+    struct thread *writer;      /* Writer holding us (for debugging). */
+    unsigned readers_waiting;   /* Number of readers blocked. */
+    unsigned writers_waiting;   /* Number of writers blocked. */
+    struct semaphore read_sema; /* Blocked readers, by priority. */
+    struct semaphore write_sema; /* Blocked writers, by priority. */
+#ifdef LOCKSTAT
+    struct lockstat *stat;      /* Statistics for our name. */
+    uint64_t acquire_time;      /* When `writer' acquired us. */
+#endif
+  };
+
+void rwlock_init (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
+void synch_reprioritize (struct thread *, bool raised);
 
 /* Optimization barrier.
 
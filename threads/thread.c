@@ -2,16 +2,23 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/schedgroup.h"
+#include "threads/softirq.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fixed_point.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -21,27 +28,35 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of process in THREAD_SLEEP state, that is, processes
-   that are not schedule run state but wait to wakeup after pass wakeup_ticks */
-static struct list sleep_list;
-
 /* List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
+   when they are first scheduled and removed when they exit.
+   Protected by all_lock, which also serializes the reaping of
+   dead threads between thread_schedule_tail() and
+   thread_release_child(). */
 static struct list all_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+static struct spinlock all_lock;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Protects the holders of locks and the priority donation
+   state of locks and threads: `priority' and `elem' in struct
+   lock, `wait_on_lock' and `held_locks' in struct thread, and
+   effective priorities that include donations. */
+struct spinlock donation_lock;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Cache of pages freed by dead threads, reused last-in first-out
+   by thread_create() while they are still warm in the CPU cache,
+   without going through the page allocator.  Accessed only with
+   interrupts off and cache_lock held. */
+#define THREAD_CACHE_SIZE 16
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+static struct spinlock cache_lock;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
   {
@@ -50,21 +65,150 @@ struct kernel_thread_frame
     void *aux;                  /* Auxiliary data for function. */
   };
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
+/* A thread's scheduling statistics, as copied by
+   thread_print_stats(). */
+struct thread_snapshot
+  {
+    tid_t tid;
+    char name[16];
+    struct schedstat stats;
+  };
+
+/* Where snapshot_thread() copies statistics. */
+struct snapshot_buf
+  {
+    struct thread_snapshot *snaps;      /* Array of MAX snapshots. */
+    size_t cnt, max;                    /* Number used, capacity. */
+    size_t total;                       /* Number of threads seen. */
+  };
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
-int64_t next_tick_to_awake = INT64_MAX; /* minimal tick of wakeup tick in sleep_list */
+#define TIME_SLICE_MS 40        /* Time to give each thread, in ms. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler (CFS).
+   Controlled by kernel command-line option "-cfs".
+
+   The CFS ignores priorities.  Instead, it runs next the ready
+   thread that has received the least CPU time, as measured by
+   its "virtual runtime".  A running thread's virtual runtime
+   advances by CFS_VTIME_MS * NICE_0_WEIGHT / w for each
+   millisecond it runs,
+   where w is the weight for its nice value in cfs_weights[], so
+   that each thread receives CPU time in proportion to its weight
+   over any interval in which the set of ready threads stays the
+   same.  The running thread is preempted when its time slice,
+   its weighted share of CFS_LATENCY_MS, runs out, or when another
+   thread on its CPU falls behind it in virtual runtime by more
+   than CFS_WAKEUP_GRANULARITY.
+
+   Each run queue's `min_vruntime' follows the least virtual
+   runtime among its running and ready threads, never
+   decreasing.  While a thread is blocked, its `vruntime' holds
+   its lead over the min_vruntime of the run queue it left, so
+   that it can be placed fairly on whichever run queue it wakes
+   up on.  A thread that slept is placed at most CFS_SLEEPER_CREDIT
+   behind min_vruntime, so that it runs soon but cannot make up
+   for all the time it slept.  A new thread starts at
+   min_vruntime.
+
+   With scheduling groups (see threads/schedgroup.h), all of the
+   above happens at two levels.  Each run queue picks the group
+   with the least virtual runtime on its CPU, which advances by
+   CFS_VTIME_MS * NICE_0_WEIGHT / w for each millisecond that any
+   of the group's threads runs, where w is the group's weight, and
+   then the group's thread with the least virtual runtime.  The
+   run queue's `min_vruntime' follows its groups, and each group
+   has a `min_vruntime' on each CPU that its threads' virtual
+   runtimes are placed against.  Groups that wake up are placed
+   like threads that wake up.  With only the root group, this
+   reduces to the plain CFS. */
+bool thread_cfs;
+
+/* If true, print scheduling statistics at shutdown.
+   Controlled by kernel command-line option "-schedstat". */
+bool thread_schedstat;
+
+/* System-wide histograms of the times that threads waited to
+   run, for any reason and after a wakeup, kept per CPU.  Bucket
+   I counts waits of at least 2**I ns but less than 2**(I+1) ns;
+   the last bucket also counts longer waits. */
+#define SCHED_HIST_BUCKETS 36
+static long long wait_hist[CPU_MAX][SCHED_HIST_BUCKETS];
+static long long wakeup_hist[CPU_MAX][SCHED_HIST_BUCKETS];
+
+/* EDF real-time class.
+
+   An EDF thread, created by thread_create_edf(), asks for
+   `edf_runtime' ticks of CPU time in every `edf_period' ticks.
+   Its first period begins when it is created, and each period
+   ends at a deadline where the next one begins.  Ready EDF
+   threads always run before other threads, whatever the
+   scheduler, and among themselves earliest deadline first.  A
+   running EDF thread is charged for each timer tick it runs.
+   Once it has used up its runtime for the period, it is
+   throttled: it sleeps until its deadline, when its budget is
+   replenished, so that it cannot starve other threads even if it
+   never blocks.  A thread that blocks and wakes up in a later
+   period starts over with a full budget in the period that
+   contains the current tick.
+
+   EDF meets every deadline on a CPU as long as the EDF threads
+   on it need no more than all of it.  thread_create_edf() refuses
+   a thread whose utilization, runtime over period in thousandths
+   rounded up, would take the total past thread_edf_bound percent
+   of one CPU.  The rest is left for other threads and for the
+   tick granularity of budgets.  The bound is taken against a
+   single CPU even with several, which is conservative.
+
+   edf_lock protects edf_util.  It also orders a throttled thread
+   going to sleep against the timeout that wakes it up. */
+#define EDF_BOUND_DEFAULT 90
+int thread_edf_bound = EDF_BOUND_DEFAULT;
+static int edf_util;
+static struct spinlock edf_lock;
+
+#define CFS_LATENCY_MS 80       /* Target latency, in ms. */
+#define CFS_MIN_GRANULARITY_MS 10 /* Minimum time slice, in ms. */
+#define CFS_VTIME_MS 128        /* Virtual runtime of a nice 0 ms. */
+#define CFS_WAKEUP_GRANULARITY (CFS_LATENCY_MS / 2 * CFS_VTIME_MS)
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY_MS / 2 * CFS_VTIME_MS)
+
+/* The time slices above, in timer ticks, and the virtual runtime
+   of a nice 0 tick, at the timer frequency chosen at boot.  Set
+   by thread_init(). */
+static unsigned time_slice;
+static unsigned cfs_latency;
+static unsigned cfs_min_granularity;
+static unsigned cfs_vtick;
+
+/* Amount added to the running thread's recent_cpu on each timer
+   tick, in fixed point, so that recent_cpu grows at the same rate
+   per second of CPU time whatever the timer frequency. */
+static int recent_cpu_tick;
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Each
+   step of nice changes a thread's share of the CPU by about 10%
+   relative to a thread at the old value, so the weights go down
+   by a factor of about 1.25 per step. */
+#define NICE_0_WEIGHT 1024
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+  };
+
 // MLFQ
 #define NICE_DEFAULT 0
 #define RECENT_CPU_DEFAULT 0
@@ -75,41 +219,99 @@ static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
-static struct thread *next_thread_to_run (void);
+static struct thread *next_thread_to_run (struct cpu *);
+static struct thread *steal_thread (struct cpu *);
+static bool is_idle_thread (const struct thread *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static void runqueue_init (struct runqueue *);
+static void ready_queue_push (struct runqueue *, struct thread *);
+static void ready_queue_remove (struct runqueue *, struct thread *);
+static int ready_queue_max_priority (const struct runqueue *);
+static struct runqueue *lock_thread_rq (struct thread *);
+static void change_priority (struct thread *, int priority);
+static void idle_loop (void) NO_RETURN;
+static struct thread *ready_queue_first (struct runqueue *, bool movable);
+static bool cfs_less (const struct rb_elem *, const struct rb_elem *,
+                      void *aux);
+static unsigned cfs_weight (const struct thread *);
+static void cfs_update_min_vruntime (struct runqueue *, struct thread *);
+static bool cfs_tick (struct cpu *, struct thread *);
+static bool cfs_should_preempt (struct thread *);
+static unsigned ms_to_ticks (int ms);
+static heap_less_func lock_priority_less;
+static tid_t create_thread (const char *name, int priority,
+                            int runtime, int period,
+                            thread_func *, void *aux);
+static heap_less_func edf_less;
+static int edf_utilization (int runtime, int period);
+static void edf_new_period (struct thread *, int64_t now);
+static bool edf_tick (struct thread *);
+static bool edf_should_preempt (struct thread *);
+static void edf_throttle (struct thread *);
+static timeout_func edf_replenish;
+static struct group_rq *group_rq (struct runqueue *, struct schedgroup *);
+static rb_less_func group_less;
+static struct thread *pick_thread (struct runqueue *, bool movable);
+static bool park_if_throttled (struct runqueue *, struct thread *);
+static void schedstat_switch (struct cpu *, struct thread *cur,
+                              struct thread *next);
+static int hist_bucket (int64_t ns);
+static void print_hist (const char *name,
+                        long long hist[CPU_MAX][SCHED_HIST_BUCKETS]);
+static thread_action_func snapshot_thread;
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the bootstrap processor's run queue and the
+   tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
-   ate().
+   thread_create().
 
    It is not safe to call thread_current() until this function
    finishes. */
 void
 thread_init (void)
 {
+  struct cpu *c = &cpus[0];
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
-  list_init (&sleep_list);
+  time_slice = ms_to_ticks (TIME_SLICE_MS);
+  cfs_latency = ms_to_ticks (CFS_LATENCY_MS);
+  cfs_min_granularity = ms_to_ticks (CFS_MIN_GRANULARITY_MS);
+  cfs_vtick = CFS_VTIME_MS * 1000 / timer_freq;
+  recent_cpu_tick = div_mixed (int_to_fp (TIMER_FREQ_DEFAULT), timer_freq);
+
+  lock_init (&tid_lock, "tid");
   list_init (&all_list);
+  spinlock_init (&all_lock);
+  spinlock_init (&cache_lock);
+  spinlock_init (&edf_lock);
+  schedgroup_init ();
+
+  c->id = 0;
+  c->online = true;
+  runqueue_init (&c->rq);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->cpu = c;
+  initial_thread->on_cpu = true;
+  c->curr = initial_thread;
   initial_thread->tid = allocate_tid ();
   // initialize init_thread (main thread) semaphore (exit, load)
   sema_init (&initial_thread->exit, 0);
@@ -130,38 +332,156 @@ thread_start (void)
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to initialize its CPU's
+     idle_thread. */
   sema_down (&idle_started);
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+   USER is true if the interrupt arrived in user mode.  Thus,
+   this function runs in an external interrupt context. */
 void
-thread_tick (void)
+thread_tick (bool user)
 {
-  struct thread *t = thread_current ();
+  struct cpu *c = cpu_current ();
+  struct thread *t = c->curr;
 
   /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
-#ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
-#endif
+  if (t == c->idle_thread)
+    c->idle_ticks++;
+  else if (user)
+    {
+      c->user_ticks++;
+      t->stats.user_ticks++;
+    }
   else
-    kernel_ticks++;
+    {
+      c->kernel_ticks++;
+      t->stats.kernel_ticks++;
+    }
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  c->thread_ticks++;
+  if (t->edf)
+    {
+      if (edf_tick (t))
+        intr_yield_on_return ();
+    }
+  else if (t != c->idle_thread && schedgroup_charge (t->group))
+    intr_yield_on_return ();
+  else if (edf_should_preempt (t))
+    intr_yield_on_return ();
+  else if (thread_cfs)
+    {
+      if (cfs_tick (c, t))
+        intr_yield_on_return ();
+    }
+  else if (c->thread_ticks >= time_slice)
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Called by the timer for each tick that passed while the CPU
+   was halted in tickless idle mode, without a timer interrupt. */
+void
+thread_idle_tick (void)
+{
+  cpu_current ()->idle_ticks++;
+}
+
+/* Prints thread statistics, summed over all CPUs, followed by
+   a line per CPU if there is more than one. */
 void
 thread_print_stats (void)
 {
+  long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      idle_ticks += cpus[i].idle_ticks;
+      kernel_ticks += cpus[i].kernel_ticks;
+      user_ticks += cpus[i].user_ticks;
+    }
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  if (cpu_cnt > 1)
+    for (i = 0; i < cpu_cnt; i++)
+      printf ("CPU %d: %lld idle ticks, %lld kernel ticks, "
+              "%lld user ticks%s\n", i, cpus[i].idle_ticks,
+              cpus[i].kernel_ticks, cpus[i].user_ticks,
+              cpus[i].online ? "" : " (offline)");
+
+  if (thread_schedstat)
+    {
+      struct snapshot_buf buf;
+      enum intr_level old_level;
+      size_t j;
+
+      print_hist ("wait", wait_hist);
+      print_hist ("wakeup", wakeup_hist);
+
+      /* Copy the statistics first, because printing may sleep
+         and thread_foreach() runs with interrupts off. */
+      buf.snaps = palloc_get_page (0);
+      if (buf.snaps == NULL)
+        return;
+      buf.max = PGSIZE / sizeof *buf.snaps;
+      buf.cnt = buf.total = 0;
+      old_level = intr_disable ();
+      thread_foreach (snapshot_thread, &buf);
+      intr_set_level (old_level);
+
+      printf ("schedstat: %5s %-16s %8s %8s %8s %8s %8s %10s %8s %8s %10s %8s\n",
+              "tid", "name", "user", "kernel", "runs", "vol", "invol",
+              "wait us", "max", "wakeups", "wakeup us", "max");
+      for (j = 0; j < buf.cnt; j++)
+        {
+          const struct thread_snapshot *snap = &buf.snaps[j];
+          const struct schedstat *st = &snap->stats;
+
+          printf ("schedstat: %5d %-16s %8lld %8lld %8lld %8lld %8lld"
+                  " %10lld %8lld %8lld %10lld %8lld\n",
+                  snap->tid, snap->name, st->user_ticks, st->kernel_ticks,
+                  st->run_cnt, st->voluntary_cnt, st->involuntary_cnt,
+                  st->wait_ns / 1000, st->wait_max_ns / 1000,
+                  st->wakeup_cnt, st->wakeup_ns / 1000,
+                  st->wakeup_max_ns / 1000);
+        }
+      if (buf.total > buf.cnt)
+        printf ("schedstat: %zu more threads not shown\n",
+                buf.total - buf.cnt);
+      palloc_free_page (buf.snaps);
+    }
+}
+
+/* Copies the scheduling statistics of the thread with the given
+   TID into *STATS.  Returns true if successful, false if there
+   is no such thread. */
+bool
+thread_get_schedstat (tid_t tid, struct schedstat *stats)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool found = false;
+
+  old_level = intr_disable ();
+  spin_lock (&all_lock);
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (t->tid == tid && t->status != THREAD_DYING)
+        {
+          *stats = t->stats;
+          found = true;
+          break;
+        }
+    }
+  spin_unlock (&all_lock);
+  intr_set_level (old_level);
+
+  return found;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -182,6 +502,58 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
+{
+  return create_thread (name, priority, 0, 0, function, aux);
+}
+
+/* Creates a new kernel thread named NAME in the EDF real-time
+   class, which executes FUNCTION passing AUX as the argument.
+   The thread is given RUNTIME ticks of CPU time in every PERIOD
+   ticks, and runs before all non-EDF threads while it has budget
+   left.  See the comment on the EDF class at the top of this
+   file.
+
+   Returns the new thread's tid, or TID_ERROR if creation fails
+   or if admitting the thread would take the total utilization
+   of EDF threads past thread_edf_bound. */
+tid_t
+thread_create_edf (const char *name, int runtime, int period,
+                   thread_func *function, void *aux)
+{
+  enum intr_level old_level;
+  int util = edf_utilization (runtime, period);
+  bool admit;
+  tid_t tid;
+
+  ASSERT (0 < runtime && runtime <= period);
+
+  old_level = intr_disable ();
+  spin_lock (&edf_lock);
+  admit = edf_util + util <= thread_edf_bound * 10;
+  if (admit)
+    edf_util += util;
+  spin_unlock (&edf_lock);
+  intr_set_level (old_level);
+  if (!admit)
+    return TID_ERROR;
+
+  tid = create_thread (name, PRI_DEFAULT, runtime, period, function, aux);
+  if (tid == TID_ERROR)
+    {
+      old_level = intr_disable ();
+      spin_lock (&edf_lock);
+      edf_util -= util;
+      spin_unlock (&edf_lock);
+      intr_set_level (old_level);
+    }
+  return tid;
+}
+
+/* Does the work of thread_create() and thread_create_edf().  The
+   new thread is an EDF thread if RUNTIME is nonzero. */
+static tid_t
+create_thread (const char *name, int priority, int runtime, int period,
+               thread_func *function, void *aux)
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
@@ -193,14 +565,26 @@ thread_create (const char *name, int priority,
 
   ASSERT (function != NULL);
 
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  /* Allocate thread.  init_thread() clears the `struct thread',
+     and the rest of the page is stack, so the page need not be
+     zeroed. */
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  t->group = thread_current ()->group;
+  schedgroup_get (t->group);
+  if (runtime != 0)
+    {
+      t->edf = true;
+      t->edf_runtime = runtime;
+      t->edf_period = period;
+      t->edf_budget = runtime;
+      t->edf_deadline = timer_ticks () + period;
+    }
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack'
@@ -225,12 +609,16 @@ thread_create (const char *name, int priority,
   intr_set_level (old_level);
 
   // Process hierachy & initialize variables,semaphores,list
-  t->parent = thread_current ();
   t->memory_load_success = false;
   t->process_dead = false;
   sema_init (&t->exit, 0);
   sema_init (&t->load, 0);
+#ifdef USERPROG
+  /* Only processes can wait for their children.  Without a
+     parent, a thread is destroyed as soon as it exits. */
+  t->parent = thread_current ();
   list_push_back (&thread_current ()->children, &t->child);
+#endif
   t->run_file = NULL;
 
   // File Descriptor initialize
@@ -266,10 +654,29 @@ thread_block (void)
   schedule ();
 }
 
+/* Like thread_block(), but also releases spin lock LOCK once the
+   current thread is marked blocked.  A thread on another CPU that
+   finds the current thread on a wait list protected by LOCK may
+   then unblock it right away, even before it has switched away;
+   thread_unblock() waits for the switch to finish. */
+void
+thread_block_unlock (struct spinlock *lock)
+{
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  thread_current ()->status = THREAD_BLOCKED;
+  spin_unlock (lock);
+  schedule ();
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
+   T is put on the run queue of the running CPU.  If the CPU is
+   busy, an idle CPU, if any, is woken up to steal T.
+
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
@@ -278,13 +685,64 @@ void
 thread_unblock (struct thread *t)
 {
   enum intr_level old_level;
+  struct cpu *c;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered (&ready_list, &t->elem, &cmp_priority, NULL);
+  trace_record (TRACE_UNBLOCK, t->tid);
+
+  /* T may have blocked on another CPU and not yet switched
+     away.  This cannot happen with one CPU, because a thread
+     that is blocking runs with interrupts off until it does. */
+  while (t->on_cpu)
+    asm volatile ("pause");
+
+  /* If T's group is out of quota, T waits for the group's next
+     period instead. */
+  if (!t->edf && schedgroup_park (t))
+    {
+      intr_set_level (old_level);
+      return;
+    }
+
+  c = cpu_current ();
+  spin_lock (&c->rq.lock);
+  t->cpu = c;
   t->status = THREAD_READY;
+  t->ready_since = clock_ns ();
+  t->woken = true;
+  if (t->edf)
+    {
+      /* Start over in the current period if T slept past its
+         deadline. */
+      int64_t now = timer_ticks ();
+      if (now >= t->edf_deadline)
+        edf_new_period (t, now);
+    }
+  else if (thread_cfs)
+    {
+      /* Turn T's lead into a virtual runtime on this CPU. */
+      if (t->vruntime < -CFS_SLEEPER_CREDIT)
+        t->vruntime = -CFS_SLEEPER_CREDIT;
+      t->vruntime += group_rq (&c->rq, t->group)->min_vruntime;
+    }
+  ready_queue_push (&c->rq, t);
+  spin_unlock (&c->rq.lock);
+
+  if (cpu_cnt > 1 && c->curr != c->idle_thread)
+    {
+      int i;
+
+      for (i = 0; i < cpu_cnt; i++)
+        if (cpus[i].online && cpus[i].curr == cpus[i].idle_thread
+            && &cpus[i] != c)
+          {
+            cpu_kick (&cpus[i]);
+            break;
+          }
+    }
   intr_set_level (old_level);
 }
 
@@ -335,9 +793,22 @@ thread_exit (void)
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
-     when it calls thread_schedule_tail(). */
+     when it calls thread_schedule_tail(), unless our parent still
+     has to collect our exit status. */
   intr_disable ();
+  if (t->edf)
+    {
+      spin_lock (&edf_lock);
+      edf_util -= edf_utilization (t->edf_runtime, t->edf_period);
+      spin_unlock (&edf_lock);
+    }
+  schedgroup_exit ();
+  while (!list_empty (&t->children))
+    thread_release_child (list_entry (list_front (&t->children),
+                                      struct thread, child));
+  spin_lock (&all_lock);
   list_remove (&thread_current ()->allelem);
+  spin_unlock (&all_lock);
   // Mark process_dead = true, Then sema_up(parent)
   thread_current ()->process_dead = true;
   if (thread_current ()->parent)
@@ -353,20 +824,32 @@ void
 thread_yield (void)
 {
   struct thread *cur = thread_current ();
+  struct cpu *c;
   enum intr_level old_level;
 
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    list_insert_ordered (&ready_list, &cur->elem, cmp_priority, NULL);
+  if (cur->edf_throttled)
+    {
+      edf_throttle (cur);
+      intr_set_level (old_level);
+      return;
+    }
+  c = cur->cpu;
+  spin_lock (&c->rq.lock);
   cur->status = THREAD_READY;
+  cur->ready_since = clock_ns ();
+  if (cur != c->idle_thread)
+    ready_queue_push (&c->rq, cur);
+  spin_unlock (&c->rq.lock);
   schedule ();
   intr_set_level (old_level);
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
-   This function must be called with interrupts off. */
+   This function must be called with interrupts off.  FUNC must
+   not call thread_create() or thread_exit(). */
 void
 thread_foreach (thread_action_func *func, void *aux)
 {
@@ -374,12 +857,14 @@ thread_foreach (thread_action_func *func, void *aux)
 
   ASSERT (intr_get_level () == INTR_OFF);
 
+  spin_lock (&all_lock);
   for (e = list_begin (&all_list); e != list_end (&all_list);
        e = list_next (e))
     {
       struct thread *t = list_entry (e, struct thread, allelem);
       func (t, aux);
     }
+  spin_unlock (&all_lock);
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -387,9 +872,12 @@ void
 thread_set_priority (int new_priority)
 {
   int old_priority = thread_current ()->priority;
+  enum intr_level old_level;
 
   if (old_priority == new_priority)
     return ;
+  old_level = intr_disable ();
+  spin_lock (&donation_lock);
   thread_current ()->init_priority = new_priority;
   if (!thread_mlfqs)
   {
@@ -397,6 +885,8 @@ thread_set_priority (int new_priority)
     if (thread_current ()->wait_on_lock != NULL)
       donate_priority ();
   }
+  spin_unlock (&donation_lock);
+  intr_set_level (old_level);
 
   test_max_priority ();
 }
@@ -421,7 +911,8 @@ thread_set_nice (int nice UNUSED)
   old_level = intr_disable ();
 
   thread_current ()->nice = nice;
-  mlfqs_priority (thread_current ());
+  if (!thread_cfs)
+    mlfqs_priority (thread_current ());
   intr_set_level (old_level);
 
   test_max_priority ();
@@ -475,26 +966,60 @@ thread_get_recent_cpu (void)
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The bootstrap processor's idle thread is initially put on the
+   ready list by thread_start().  It will be scheduled once
+   initially, at which point it initializes its CPU's
+   idle_thread, "up"s the semaphore passed to it to enable
+   thread_start() to continue, and immediately blocks.  After
+   that, the idle thread never appears in the ready list.  It is
+   returned by next_thread_to_run() as a special case when the
+   ready list is empty.
+
+   The idle threads of the other CPUs are set up by
+   thread_prepare_ap() instead. */
 static void
 idle (void *idle_started_ UNUSED)
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  cpu_current ()->idle_thread = thread_current ();
+  intr_set_level (old_level);
   sema_up (idle_started);
 
+  idle_loop ();
+}
+
+/* Body of every CPU's idle thread. */
+static void
+idle_loop (void)
+{
   for (;;)
     {
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
 
+      /* Softirqs raised outside an interrupt, or left over by one,
+         would otherwise wait for the next interrupt.  Running
+         them may wake up a thread, so block again afterward. */
+      if (softirq_pending ())
+        {
+          softirq_run ();
+          continue;
+        }
+
+      /* Zero a free page for later PAL_ZERO allocations.  This
+         turns interrupts on for a while, which may wake up a
+         thread, so block again afterward. */
+      if (palloc_zero_idle ())
+        continue;
+
+      /* In tickless mode, stop the periodic timer tick until the
+         next timeout is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -507,10 +1032,57 @@ idle (void *idle_started_ UNUSED)
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
+#ifdef IRQSOFF
+      irqsoff_stop ();
+#endif
       asm volatile ("sti; hlt" : : : "memory");
     }
 }
 
+/* Allocates and initializes the idle thread for application
+   processor C, which is not running yet, and returns it, or a
+   null pointer if memory is exhausted.  The AP starts out on the
+   returned thread's stack and then calls thread_start_ap(). */
+struct thread *
+thread_prepare_ap (struct cpu *c)
+{
+  struct thread *t;
+  char name[16];
+
+  ASSERT (c != &cpus[0]);
+
+  t = alloc_thread_page ();
+  if (t == NULL)
+    return NULL;
+
+  snprintf (name, sizeof name, "idle%d", c->id);
+  init_thread (t, name, PRI_MIN);
+  t->tid = allocate_tid ();
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+  t->on_cpu = true;
+  c->idle_thread = t;
+  c->curr = t;
+  runqueue_init (&c->rq);
+  return t;
+}
+
+/* Called by an application processor, running on the stack of
+   the idle thread that thread_prepare_ap() set up for it, once
+   its hardware is initialized.  Starts scheduling threads on
+   the AP.  Interrupts must be off. */
+void
+thread_start_ap (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t == t->cpu->idle_thread);
+
+  t->cpu->online = true;
+  idle_loop ();
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux)
@@ -548,6 +1120,8 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -559,12 +1133,17 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->magic = THREAD_MAGIC;
   t->init_priority = priority;
-  list_init (&t->donations);
   t->wait_on_lock = NULL;
+  heap_init (&t->held_locks, lock_priority_less, NULL);
   t->nice = NICE_DEFAULT;
   t->recent_cpu = RECENT_CPU_DEFAULT;
+  t->group = &root_group;
 
+  old_level = intr_disable ();
+  spin_lock (&all_lock);
   list_push_back (&all_list, &t->allelem);
+  spin_unlock (&all_lock);
+  intr_set_level (old_level);
 
   // Initialize child list
   list_init (&t->children);
@@ -583,18 +1162,288 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
+/* Chooses and returns the next thread for CPU C to run.  Should
+   return a thread from C's run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   will be in the run queue.)  If the run queue is empty, tries to
+   steal a thread from another CPU, and failing that returns C's
+   idle thread.
+
+   The chosen thread is marked running at once, so that no one
+   takes it for a thread still on a run queue. */
+static struct thread *
+next_thread_to_run (struct cpu *c)
+{
+  struct runqueue *rq = &c->rq;
+  struct thread *t;
+
+  spin_lock (&rq->lock);
+  t = pick_thread (rq, false);
+  if (t != NULL)
+    {
+      ready_queue_remove (rq, t);
+      t->status = THREAD_RUNNING;
+      if (thread_cfs && !t->edf)
+        cfs_update_min_vruntime (rq, t);
+    }
+  spin_unlock (&rq->lock);
+
+  if (t == NULL && cpu_cnt > 1)
+    t = steal_thread (c);
+  return t != NULL ? t : c->idle_thread;
+}
+
+/* Takes the highest priority thread that can be moved from the
+   run queue of some other CPU, for CPU C to run, and returns it,
+   or a null pointer if there is none.  A thread that has not
+   finished switching away from its CPU cannot be moved.  Busy
+   run queues are skipped rather than waited for. */
+static struct thread *
+steal_thread (struct cpu *c)
+{
+  int i;
+
+  for (i = 1; i < cpu_cnt; i++)
+    {
+      struct cpu *victim = &cpus[(c->id + i) % cpu_cnt];
+      struct runqueue *rq = &victim->rq;
+      struct thread *t;
+
+      if (!victim->online || rq->cnt == 0 || !spin_trylock (&rq->lock))
+        continue;
+      t = pick_thread (rq, true);
+      if (t != NULL)
+        {
+          ready_queue_remove (rq, t);
+          t->status = THREAD_RUNNING;
+          t->cpu = c;
+
+          /* Keep T's lead over min_vruntime.  Only C itself
+             changes its min_vruntime, so we may read it without
+             holding its lock. */
+          if (thread_cfs)
+            t->vruntime += (group_rq (&c->rq, t->group)->min_vruntime
+                            - group_rq (rq, t->group)->min_vruntime);
+        }
+      spin_unlock (&rq->lock);
+      if (t != NULL)
+        return t;
+    }
+  return NULL;
+}
+
+/* Returns true if T is some CPU's idle thread. */
+static bool
+is_idle_thread (const struct thread *t)
+{
+  return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
+/* Initializes run queue RQ as empty. */
+static void
+runqueue_init (struct runqueue *rq)
+{
+  int pri;
+
+  spinlock_init (&rq->lock);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&rq->queues[pri]);
+  rq->bitmap = 0;
+  rbtree_init (&rq->tree, group_less, NULL);
+  rq->min_vruntime = 0;
+  rq->load = 0;
+  heap_init (&rq->edf, edf_less, NULL);
+  rq->cnt = 0;
+}
+
+/* Appends ready thread T to the queue for its priority in RQ,
+   or under the CFS inserts it into the tree of its group's part
+   of RQ by its virtual runtime, putting the group into RQ's tree
+   if T is its first thread there.  An EDF thread goes into RQ's
+   EDF heap instead.  RQ's lock must be held. */
+static void
+ready_queue_push (struct runqueue *rq, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  if (t->edf)
+    heap_push (&rq->edf, &t->edf_elem);
+  else if (thread_cfs)
+    {
+      struct group_rq *grq = group_rq (rq, t->group);
+
+      rbtree_insert (&grq->tree, &t->cfs_elem);
+      if (grq->cnt++ == 0)
+        {
+          /* Place a group that wakes up like a thread that does. */
+          if (grq->vruntime < rq->min_vruntime - CFS_SLEEPER_CREDIT)
+            grq->vruntime = rq->min_vruntime - CFS_SLEEPER_CREDIT;
+          rbtree_insert (&rq->tree, &grq->elem);
+        }
+      rq->load += cfs_weight (t);
+    }
+  else
+    {
+      list_push_back (&rq->queues[t->priority], &t->elem);
+      rq->bitmap |= (uint64_t) 1 << t->priority;
+    }
+  rq->cnt++;
+}
+
+/* Removes ready thread T from RQ, whose lock must be held. */
+static void
+ready_queue_remove (struct runqueue *rq, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  if (t->edf)
+    heap_remove (&rq->edf, &t->edf_elem);
+  else if (thread_cfs)
+    {
+      struct group_rq *grq = group_rq (rq, t->group);
+
+      rbtree_remove (&grq->tree, &t->cfs_elem);
+      if (--grq->cnt == 0)
+        rbtree_remove (&rq->tree, &grq->elem);
+      rq->load -= cfs_weight (t);
+    }
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&rq->queues[t->priority]))
+        rq->bitmap &= ~((uint64_t) 1 << t->priority);
+    }
+  rq->cnt--;
+}
+
+/* Returns the thread in RQ that should run first, without
+   removing it, or a null pointer if RQ is empty.  If MOVABLE is
+   true, skips threads that have not finished switching away
+   from their CPU, so that the result may run on another CPU.
+   RQ's lock must be held. */
 static struct thread *
-next_thread_to_run (void)
+ready_queue_first (struct runqueue *rq, bool movable)
+{
+  /* Only the EDF thread with the earliest deadline is
+     considered, so that no EDF thread is moved ahead of it. */
+  if (!heap_empty (&rq->edf))
+    {
+      struct thread *t = heap_entry (heap_top (&rq->edf),
+                                     struct thread, edf_elem);
+      if (!movable || !t->on_cpu)
+        return t;
+    }
+
+  if (thread_cfs)
+    {
+      struct rb_elem *g, *e;
+
+      for (g = rbtree_min (&rq->tree); g != NULL; g = rbtree_next (g))
+        {
+          struct group_rq *grq = rb_entry (g, struct group_rq, elem);
+
+          for (e = rbtree_min (&grq->tree); e != NULL; e = rbtree_next (e))
+            {
+              struct thread *t = rb_entry (e, struct thread, cfs_elem);
+              if (!movable || !t->on_cpu)
+                return t;
+            }
+        }
+    }
+  else
+    {
+      int pri;
+
+      for (pri = ready_queue_max_priority (rq); pri >= PRI_MIN; pri--)
+        if (rq->bitmap & ((uint64_t) 1 << pri))
+          {
+            struct list_elem *e;
+
+            for (e = list_begin (&rq->queues[pri]);
+                 e != list_end (&rq->queues[pri]); e = list_next (e))
+              {
+                struct thread *t = list_entry (e, struct thread, elem);
+                if (!movable || !t->on_cpu)
+                  return t;
+              }
+          }
+    }
+  return NULL;
+}
+
+/* Returns the highest priority among the threads in RQ, or -1
+   if RQ is empty.  This is a find-last-set on RQ's bitmap, done
+   as two 32-bit bit scans so that it needs no help from
+   libgcc. */
+static int
+ready_queue_max_priority (const struct runqueue *rq)
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  uint32_t hi = rq->bitmap >> 32;
+  uint32_t lo = rq->bitmap;
+
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return 31 - __builtin_clz (lo);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return -1;
+}
+
+/* Acquires the lock on the run queue of the CPU that T belongs
+   to and returns the run queue.  T's CPU can change until the
+   lock is held, so this retries until it catches T in place.
+   Interrupts must be off. */
+static struct runqueue *
+lock_thread_rq (struct thread *t)
+{
+  for (;;)
+    {
+      struct cpu *c = t->cpu;
+
+      if (c == NULL)
+        return NULL;
+      spin_lock (&c->rq.lock);
+      if (t->cpu == c)
+        return &c->rq;
+      spin_unlock (&c->rq.lock);
+    }
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is on a run
+   queue, it is moved to the tail of the queue for its new
+   priority.  If T is waiting on a semaphore or condition
+   variable, it is moved within its waiters. */
+static void
+change_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+  struct runqueue *rq;
+  int old_priority;
+
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  rq = lock_thread_rq (t);
+  old_priority = t->priority;
+  if (old_priority != priority)
+    {
+      if (t->status == THREAD_READY && !is_idle_thread (t))
+        {
+          ready_queue_remove (rq, t);
+          t->priority = priority;
+          ready_queue_push (rq, t);
+        }
+      else
+        t->priority = priority;
+    }
+  if (rq != NULL)
+    spin_unlock (&rq->lock);
+  if (old_priority != priority)
+    synch_reprioritize (t, priority > old_priority);
+  intr_set_level (old_level);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -617,6 +1466,7 @@ void
 thread_schedule_tail (struct thread *prev)
 {
   struct thread *cur = running_thread ();
+  bool reap = false;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
@@ -624,25 +1474,109 @@ thread_schedule_tail (struct thread *prev)
   cur->status = THREAD_RUNNING;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
 #endif
 
-  /* If the thread we switched from is dying, destroy its struct
+  /* PREV's registers are saved and we are off its stack, so
+     another CPU may run it now.
+
+     If the thread we switched from is dying, destroy its struct
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
      palloc().) */
-  if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
+  if (prev != NULL)
     {
-      ASSERT (prev != cur);
-      // palloc_free_page (prev);
+      spin_lock (&all_lock);
+      prev->on_cpu = false;
+      if (prev->status == THREAD_DYING && prev != initial_thread)
+        {
+          ASSERT (prev != cur);
+          reap = prev->parent == NULL;
+        }
+      spin_unlock (&all_lock);
+      if (reap)
+        free_thread_page (prev);
     }
 }
 
+/* Called by a parent thread when it no longer needs the `struct
+   thread' of CHILD, that is, after waiting for it or when the
+   parent exits.  Removes CHILD from the parent's list of
+   children.  If CHILD is already dead, destroys it; otherwise,
+   CHILD will be destroyed as soon as it finishes exiting. */
+void
+thread_release_child (struct thread *child)
+{
+  enum intr_level old_level;
+  bool reap;
+
+  ASSERT (is_thread (child));
+  ASSERT (child->parent == thread_current ());
+
+  old_level = intr_disable ();
+  list_remove (&child->child);
+  spin_lock (&all_lock);
+  child->parent = NULL;
+
+  /* A dying child that is off its CPU has switched away for
+     good.  If it is still on its CPU, thread_schedule_tail()
+     will destroy it. */
+  reap = child->status == THREAD_DYING && !child->on_cpu;
+  spin_unlock (&all_lock);
+  if (reap)
+    free_thread_page (child);
+  intr_set_level (old_level);
+}
+
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible, or a null pointer if no memory is
+   available. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  spin_lock (&cache_lock);
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  spin_unlock (&cache_lock);
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Destroys dead thread T, keeping its page in the cache if there
+   is room and returning it to the page allocator otherwise.
+   Must be called with interrupts off. */
+static void
+free_thread_page (struct thread *t)
+{
+  bool cached = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t != initial_thread);
+
+  t->magic = 0;
+  spin_lock (&cache_lock);
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    {
+      thread_cache[thread_cache_cnt++] = t;
+      cached = true;
+    }
+  spin_unlock (&cache_lock);
+  if (!cached)
+    palloc_free_page (t);
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -654,15 +1588,37 @@ static void
 schedule (void)
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct cpu *c = cur->cpu;
+  struct thread *next;
   struct thread *prev = NULL;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+
+  /* A thread that blocks keeps only its lead over this CPU's
+     min_vruntime.  Only this CPU changes its min_vruntime. */
+  if (thread_cfs && cur->status == THREAD_BLOCKED && cur != c->idle_thread
+      && !cur->edf)
+    cur->vruntime -= group_rq (&c->rq, cur->group)->min_vruntime;
+
+  next = next_thread_to_run (c);
   ASSERT (is_thread (next));
 
+  /* Leaving the idle thread ends any tickless countdown. */
+  if (cur == c->idle_thread)
+    timer_idle_exit ();
+
+  if (cur->status == THREAD_BLOCKED && cur != c->idle_thread)
+    trace_record (TRACE_BLOCK, 0);
+  schedstat_switch (c, cur, next);
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      trace_record (TRACE_SWITCH, next->tid);
+      next->cpu = c;
+      next->on_cpu = true;
+      c->curr = next;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -685,140 +1641,107 @@ allocate_tid (void)
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
 void
-thread_sleep (int64_t ticks)
+test_max_priority (void)
 {
-  struct thread *t = NULL;
   enum intr_level old_level;
+  bool preempt;
 
   old_level = intr_disable ();
-  t = thread_current ();
-  if (t != idle_thread)
-  {
-    t->wakeup_tick = ticks;
-    update_next_tick_to_awake (ticks);
-  }
-  list_push_back (&sleep_list, &(t->elem));
-
-  thread_block ();
-
+  if (edf_should_preempt (thread_current ()))
+    preempt = true;
+  else if (thread_current ()->edf)
+    preempt = false;
+  else if (thread_cfs)
+    preempt = cfs_should_preempt (thread_current ());
+  else
+    preempt = (thread_current ()->priority
+               < ready_queue_max_priority (&thread_current ()->cpu->rq));
   intr_set_level (old_level);
-}
 
-void
-thread_awake (int64_t ticks)
-{
-  struct list_elem *e = NULL;
-  struct thread *t = NULL;
-  for (e = list_begin (&sleep_list); e != list_end (&sleep_list); e = list_next (e))
-  {
-    t = list_entry (e, struct thread, elem);
-    if (t->wakeup_tick <= ticks)
+  if (preempt)
     {
-      e = list_prev(e);
-      list_remove (e->next);
-      thread_unblock(t);
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
     }
-    else
-      update_next_tick_to_awake(ticks);
-  }
-}
-
-void
-update_next_tick_to_awake (int64_t ticks)
-{
-  if (ticks < get_next_tick_to_awake())
-    next_tick_to_awake = ticks;
-}
-
-int64_t
-get_next_tick_to_awake (void)
-{
-  return next_tick_to_awake;
-}
-
-void
-test_max_priority (void)
-{
-  struct thread *cur = NULL;
-  struct thread *t = NULL;
-
-  if (!list_empty(&ready_list))
-  {
-    cur = thread_current ();
-    t = list_entry (list_begin(&ready_list), struct thread, elem);
-    if (cur->priority < t->priority)
-      thread_yield ();
-  }
-}
-
-bool
-cmp_priority (const struct list_elem *a_,
-              const struct list_elem *b_, void *aux UNUSED)
-{
-  if (list_entry (a_, struct thread, elem)->priority >
-      list_entry (b_, struct thread, elem)->priority)
-    return true;
-  else
-    return false;
 }
 
+/* Donates the running thread's priority down the chain of locks
+   that starts with the one it is waiting on.  Each lock on the
+   chain is raised to at least our priority, along with its
+   place in its holder's `held_locks', and so is each holder
+   that is lower.  The walk stops at the first lock or holder
+   that already has our priority, because everything beyond it
+   must have it too, so a chain of any length takes time linear
+   in the number of threads actually raised.  Must be called
+   with donation_lock held. */
 void
 donate_priority (void)
 {
-  struct thread *cur  = NULL;
-  struct lock *target = NULL;
-  int depth = 0, limit = 8;
+  int priority = thread_current ()->priority;
+  struct lock *lock = thread_current ()->wait_on_lock;
 
-  cur = thread_current ();
-  target = cur->wait_on_lock;
-
-  while (target != NULL && depth < limit) {
-    depth++;
-    target->holder->priority = cur->priority;
-    target = target->holder->wait_on_lock;
-  }
+  while (lock != NULL && lock->priority < priority)
+    {
+      struct thread *holder = lock->holder;
+
+      lock->priority = priority;
+      if (holder == NULL)
+        break;
+      heap_increase (&holder->held_locks, &lock->elem);
+      if (holder->priority >= priority)
+        break;
+      change_priority (holder, priority);
+      lock = holder->wait_on_lock;
+    }
 }
 
+/* Recomputes the running thread's priority as the higher of
+   its own and the highest priority donated through any lock it
+   holds.  Takes constant time.  Must be called with
+   donation_lock held. */
 void
-remove_with_lock (struct lock *lock)
+refresh_priority (void)
 {
-  struct list_elem *it;
   struct thread *cur = thread_current ();
-  struct thread *check_t = NULL;
+  int priority = cur->init_priority;
 
-  for (it = list_begin (&cur->donations);
-       it != list_end (&cur->donations); it = list_next (it))
-  {
-    check_t = list_entry (it, struct thread, donation_elem);
-    if (check_t->wait_on_lock == lock)
-      list_remove (&check_t->donation_elem);
-  }
+  if (!heap_empty (&cur->held_locks))
+    {
+      struct lock *top = heap_entry (heap_top (&cur->held_locks),
+                                     struct lock, elem);
+      if (top->priority > priority)
+        priority = top->priority;
+    }
+  cur->priority = priority;
 }
 
-void
-refresh_priority(void)
+/* Orders the locks that a thread holds by the priorities
+   donated through them. */
+static bool
+lock_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+                    void *aux UNUSED)
 {
-  struct list_elem *it;
-  struct thread *cur = thread_current ();
-  struct thread *check_t;
-  int max = cur->init_priority;
-
-  for (it = list_begin (&thread_current ()->donations);
-       it != list_end (&thread_current ()->donations); it = list_next (it))
-  {
-    check_t = list_entry (it, struct thread, donation_elem);
-    if (max < check_t->priority)
-      max = check_t->priority;
-  }
-  thread_current ()->priority = max;
+  return (heap_entry (a, struct lock, elem)->priority
+          < heap_entry (b, struct lock, elem)->priority);
 }
 
 // MLFQ
 void
 mlfqs_priority (struct thread *t)
 {
-  if (t != idle_thread)
-    t->priority = PRI_MAX - fp_to_int (div_mixed (t->recent_cpu, 4)) - t->nice * 2;
+  int priority;
+
+  if (is_idle_thread (t))
+    return;
+
+  priority = PRI_MAX - fp_to_int (div_mixed (t->recent_cpu, 4)) - t->nice * 2;
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  change_priority (t, priority);
 }
 
 void
@@ -826,7 +1749,7 @@ mlfqs_recent_cpu (struct thread *t)
 {
   /* 해당 스레드가 idle_thread 가 아닌지 검사 */
   /*recent_cpu계산식을 구현 (fixed_point.h의 계산함수 이용)*/
-  if (t != idle_thread)
+  if (!is_idle_thread (t))
   {
     int two_m_load_avg = mult_mixed (load_avg, 2);
     t->recent_cpu = add_mixed (
@@ -845,9 +1768,19 @@ mlfqs_recent_cpu (struct thread *t)
 void
 mlfqs_load_avg (void)
 {
-  int num_threads = list_size (&ready_list);
-  if (thread_current () != idle_thread)
-    num_threads++;
+  int num_threads = 0;
+  int i;
+
+  /* Count ready threads and the threads running on each CPU.
+     This is called from the timer interrupt, possibly while the
+     idle thread is switching away, so it must not use
+     thread_current(). */
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      num_threads += cpus[i].rq.cnt;
+      if (cpus[i].curr != cpus[i].idle_thread)
+        num_threads++;
+    }
 
   load_avg = add_fp (mult_fp (div_mixed (int_to_fp (59), 60), load_avg), mult_mixed (div_mixed (int_to_fp (1), 60), num_threads));
   if (fp_to_int (load_avg) < 0)
@@ -860,8 +1793,8 @@ mlfqs_increment (void)
   /* 해당 스레드가 idle_thread 가 아닌지 검사 */
   /* 현재 스레드의 recent_cpu 값을 1증가 시킨다. */
   struct thread *cur = thread_current ();
-  if (cur != idle_thread)
-    cur->recent_cpu = add_mixed (cur->recent_cpu, 1);
+  if (!is_idle_thread (cur))
+    cur->recent_cpu = add_fp (cur->recent_cpu, recent_cpu_tick);
 }
 
 void
@@ -870,10 +1803,446 @@ mlfqs_recalc (void)
   struct list_elem *it;
   struct thread *e;
 
+  spin_lock (&all_lock);
   for (it = list_begin (&all_list); it != list_end (&all_list); it = list_next (it))
   {
     e = list_entry (it, struct thread, allelem);
     mlfqs_recent_cpu (e);
     mlfqs_priority (e);
   }
+  spin_unlock (&all_lock);
+}
+
+/* Compares the virtual runtimes of threads A and B, which are in
+   a run queue's tree. */
+static bool
+cfs_less (const struct rb_elem *a_, const struct rb_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = rb_entry (a_, struct thread, cfs_elem);
+  const struct thread *b = rb_entry (b_, struct thread, cfs_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Returns T's weight for its nice value. */
+static unsigned
+cfs_weight (const struct thread *t)
+{
+  int nice = t->nice;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+  return cfs_weights[nice - NICE_MIN];
+}
+
+/* Advances the min_vruntime of CURR's group in RQ to the least
+   virtual runtime among CURR, the thread running on RQ's CPU,
+   and the group's threads in RQ, and RQ's min_vruntime to the
+   least virtual runtime among CURR's group and the groups in RQ.
+   RQ's lock must be held, by RQ's own CPU. */
+static void
+cfs_update_min_vruntime (struct runqueue *rq, struct thread *curr)
+{
+  struct group_rq *grq = group_rq (rq, curr->group);
+  struct rb_elem *e = rbtree_min (&grq->tree);
+  int64_t min = curr->vruntime;
+
+  if (e != NULL && rb_entry (e, struct thread, cfs_elem)->vruntime < min)
+    min = rb_entry (e, struct thread, cfs_elem)->vruntime;
+  if (min > grq->min_vruntime)
+    grq->min_vruntime = min;
+
+  e = rbtree_min (&rq->tree);
+  min = grq->vruntime;
+  if (e != NULL && rb_entry (e, struct group_rq, elem)->vruntime < min)
+    min = rb_entry (e, struct group_rq, elem)->vruntime;
+  if (min > rq->min_vruntime)
+    rq->min_vruntime = min;
+}
+
+/* Charges T, running on CPU C, for a timer tick.  Returns true
+   if T has used up its time slice, which is its weighted share
+   of CFS_LATENCY_MS among the threads on C, or of a longer
+   period if there are too many threads for each to get
+   CFS_MIN_GRANULARITY_MS.  Takes constant time. */
+static bool
+cfs_tick (struct cpu *c, struct thread *t)
+{
+  struct runqueue *rq = &c->rq;
+  struct group_rq *grq;
+  unsigned weight, period, slice;
+  bool expired;
+
+  if (t == c->idle_thread)
+    return false;
+
+  weight = cfs_weight (t);
+  spin_lock (&rq->lock);
+  t->vruntime += cfs_vtick * NICE_0_WEIGHT / weight;
+
+  /* T's group may be in RQ's tree, keyed by its virtual
+     runtime. */
+  grq = group_rq (rq, t->group);
+  if (grq->cnt > 0)
+    rbtree_remove (&rq->tree, &grq->elem);
+  grq->vruntime += cfs_vtick * NICE_0_WEIGHT / t->group->weight;
+  if (grq->cnt > 0)
+    rbtree_insert (&rq->tree, &grq->elem);
+  cfs_update_min_vruntime (rq, t);
+
+  period = cfs_latency;
+  if (rq->cnt + 1 > cfs_latency / cfs_min_granularity)
+    period = (rq->cnt + 1) * cfs_min_granularity;
+  slice = period * weight / (rq->load + weight);
+  if (slice < cfs_min_granularity)
+    slice = cfs_min_granularity;
+  expired = rq->cnt > 0 && c->thread_ticks >= slice;
+  spin_unlock (&rq->lock);
+
+  return expired;
+}
+
+/* Returns true if running thread CUR should yield to a thread
+   in its CPU's run queue, because CUR is the idle thread, because
+   CUR's group is ahead of the first group in virtual runtime by
+   more than CFS_WAKEUP_GRANULARITY, or because CUR is ahead of
+   the first thread in its own group by that much.  Interrupts
+   must be off. */
+static bool
+cfs_should_preempt (struct thread *cur)
+{
+  struct runqueue *rq = &cur->cpu->rq;
+  struct rb_elem *e;
+  bool preempt = false;
+
+  spin_lock (&rq->lock);
+  e = rbtree_min (&rq->tree);
+  if (e != NULL)
+    {
+      struct group_rq *grq = group_rq (rq, cur->group);
+
+      if (is_idle_thread (cur)
+          || (grq->vruntime - rb_entry (e, struct group_rq, elem)->vruntime
+              > CFS_WAKEUP_GRANULARITY))
+        preempt = true;
+      else
+        {
+          e = rbtree_min (&grq->tree);
+          preempt = (e != NULL
+                     && (cur->vruntime
+                         - rb_entry (e, struct thread, cfs_elem)->vruntime
+                         > CFS_WAKEUP_GRANULARITY));
+        }
+    }
+  spin_unlock (&rq->lock);
+  return preempt;
+}
+
+/* Converts MS milliseconds into timer ticks, rounding up. */
+static unsigned
+ms_to_ticks (int ms)
+{
+  return DIV_ROUND_UP (ms * timer_freq, 1000);
+}
+
+/* Updates the scheduling statistics as CPU C switches from CUR
+   to NEXT, which may be the same thread. */
+static void
+schedstat_switch (struct cpu *c, struct thread *cur, struct thread *next)
+{
+  if (cur != next && cur != c->idle_thread)
+    {
+      if (cur->status == THREAD_BLOCKED)
+        cur->stats.voluntary_cnt++;
+      else if (cur->status == THREAD_READY)
+        cur->stats.involuntary_cnt++;
+    }
+
+  if (next != c->idle_thread)
+    {
+      struct schedstat *st = &next->stats;
+      int64_t wait = clock_ns () - next->ready_since;
+
+      st->run_cnt++;
+      st->wait_ns += wait;
+      if (wait > st->wait_max_ns)
+        st->wait_max_ns = wait;
+      wait_hist[c->id][hist_bucket (wait)]++;
+      if (next->woken)
+        {
+          next->woken = false;
+          st->wakeup_cnt++;
+          st->wakeup_ns += wait;
+          if (wait > st->wakeup_max_ns)
+            st->wakeup_max_ns = wait;
+          wakeup_hist[c->id][hist_bucket (wait)]++;
+        }
+    }
+}
+
+/* Returns the histogram bucket for a wait of NS nanoseconds,
+   that is, floor(log2(NS)), limited to the histogram's size. */
+static int
+hist_bucket (int64_t ns)
+{
+  int bucket = 0;
+
+  while (ns > 1 && bucket < SCHED_HIST_BUCKETS - 1)
+    {
+      ns >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Prints histogram HIST, summed over all CPUs, under NAME. */
+static void
+print_hist (const char *name, long long hist[CPU_MAX][SCHED_HIST_BUCKETS])
+{
+  int i, j;
+
+  for (i = 0; i < SCHED_HIST_BUCKETS; i++)
+    {
+      long long cnt = 0;
+
+      for (j = 0; j < cpu_cnt; j++)
+        cnt += hist[j][i];
+      if (cnt != 0)
+        printf ("schedstat: %s >= %12lld ns: %lld\n",
+                name, 1LL << i, cnt);
+    }
+}
+
+/* Thread action function for thread_print_stats() that copies
+   T's statistics into the snapshot_buf AUX. */
+static void
+snapshot_thread (struct thread *t, void *buf_)
+{
+  struct snapshot_buf *buf = buf_;
+
+  if (buf->cnt < buf->max && t->status != THREAD_DYING)
+    {
+      struct thread_snapshot *snap = &buf->snaps[buf->cnt++];
+
+      snap->tid = t->tid;
+      strlcpy (snap->name, t->name, sizeof snap->name);
+      snap->stats = t->stats;
+    }
+  buf->total++;
+}
+
+/* Orders EDF threads so that the one with the earliest deadline
+   is on top of the heap. */
+static bool
+edf_less (const struct heap_elem *a, const struct heap_elem *b,
+          void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, edf_elem)->edf_deadline
+          > heap_entry (b, struct thread, edf_elem)->edf_deadline);
+}
+
+/* Returns the share of a CPU, in thousandths, claimed by an EDF
+   thread that runs RUNTIME ticks every PERIOD ticks. */
+static int
+edf_utilization (int runtime, int period)
+{
+  return DIV_ROUND_UP (runtime * 1000, period);
+}
+
+/* Moves EDF thread T, whose deadline is not after NOW, into the
+   period that contains NOW, with a full budget. */
+static void
+edf_new_period (struct thread *t, int64_t now)
+{
+  ASSERT (now >= t->edf_deadline);
+
+  t->edf_deadline += ((now - t->edf_deadline) / t->edf_period + 1)
+                     * t->edf_period;
+  t->edf_budget = t->edf_runtime;
+}
+
+/* Charges running EDF thread T for a timer tick.  Returns true
+   if T should yield the CPU, because it has used up its budget
+   for this period or because a thread with an earlier deadline
+   is ready. */
+static bool
+edf_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (now >= t->edf_deadline)
+    edf_new_period (t, now);
+  if (--t->edf_budget <= 0)
+    {
+      t->edf_throttled = true;
+      return true;
+    }
+  return edf_should_preempt (t);
+}
+
+/* Returns true if an EDF thread on the run queue of CUR's CPU
+   should preempt CUR, the running thread.  An EDF thread
+   preempts any other thread, and another EDF thread only if its
+   deadline is earlier.  Interrupts must be off. */
+static bool
+edf_should_preempt (struct thread *cur)
+{
+  struct runqueue *rq = &cur->cpu->rq;
+  bool preempt = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Skip the lock in the common case of no EDF threads. */
+  if (heap_empty (&rq->edf))
+    return false;
+
+  spin_lock (&rq->lock);
+  if (!heap_empty (&rq->edf))
+    preempt = (!cur->edf || is_idle_thread (cur)
+               || (heap_entry (heap_top (&rq->edf), struct thread,
+                               edf_elem)->edf_deadline
+                   < cur->edf_deadline));
+  spin_unlock (&rq->lock);
+  return preempt;
+}
+
+/* Puts running EDF thread CUR, which has used up its budget, to
+   sleep until its deadline.  Interrupts must be off. */
+static void
+edf_throttle (struct thread *cur)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cur->edf_throttled);
+
+  spin_lock (&edf_lock);
+  timeout_init (&cur->edf_timer, edf_replenish, cur);
+  timeout_add (&cur->edf_timer, cur->edf_deadline);
+  thread_block_unlock (&edf_lock);
+}
+
+/* Timeout function that replenishes the budget of throttled EDF
+   thread T_ at its deadline and wakes it up. */
+static void
+edf_replenish (void *t_)
+{
+  struct thread *t = t_;
+  enum intr_level old_level;
+  int64_t now = timer_ticks ();
+
+  old_level = intr_disable ();
+  spin_lock (&edf_lock);
+  if (now >= t->edf_deadline)
+    edf_new_period (t, now);
+  t->edf_throttled = false;
+  spin_unlock (&edf_lock);
+  thread_unblock (t);
+  intr_set_level (old_level);
+}
+
+/* Returns the part of run queue RQ that belongs to group G. */
+static struct group_rq *
+group_rq (struct runqueue *rq, struct schedgroup *g)
+{
+  struct cpu *c = (struct cpu *) ((uint8_t *) rq
+                                  - offsetof (struct cpu, rq));
+  return &g->rqs[c->id];
+}
+
+/* Compares the virtual runtimes of the groups that own group_rqs
+   A and B, which are in a run queue's tree. */
+static bool
+group_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED)
+{
+  const struct group_rq *a = rb_entry (a_, struct group_rq, elem);
+  const struct group_rq *b = rb_entry (b_, struct group_rq, elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Initializes the parts of each CPU's run queue that belong to
+   new group G. */
+void
+thread_init_group (struct schedgroup *g)
+{
+  int i;
+
+  for (i = 0; i < CPU_MAX; i++)
+    {
+      struct group_rq *grq = &g->rqs[i];
+
+      rbtree_init (&grq->tree, cfs_less, NULL);
+      grq->min_vruntime = 0;
+      grq->cnt = 0;
+      grq->vruntime = 0;
+    }
+}
+
+/* Moves the running thread into group G, keeping its lead over
+   its group's min_vruntime, and returns the group it was in.
+   The caller must pass in a reference to G and receives the
+   reference to the old group. */
+struct schedgroup *
+thread_set_group (struct schedgroup *g)
+{
+  struct thread *cur = thread_current ();
+  struct schedgroup *old;
+  enum intr_level old_level;
+  struct runqueue *rq;
+
+  old_level = intr_disable ();
+  rq = &cur->cpu->rq;
+  spin_lock (&rq->lock);
+  old = cur->group;
+  if (thread_cfs)
+    cur->vruntime += (group_rq (rq, g)->min_vruntime
+                      - group_rq (rq, old)->min_vruntime);
+  cur->group = g;
+  spin_unlock (&rq->lock);
+  intr_set_level (old_level);
+
+  return old;
+}
+
+/* Returns the thread in RQ that should run first, like
+   ready_queue_first(), after parking the threads ahead of it
+   whose groups are throttled.  RQ's lock must be held. */
+static struct thread *
+pick_thread (struct runqueue *rq, bool movable)
+{
+  struct thread *t;
+
+  do
+    t = ready_queue_first (rq, movable);
+  while (t != NULL && park_if_throttled (rq, t));
+  return t;
+}
+
+/* If ready thread T in RQ belongs to a throttled group, moves T
+   from RQ to the group's parked threads and returns true.
+   Otherwise, returns false.  RQ's lock must be held. */
+static bool
+park_if_throttled (struct runqueue *rq, struct thread *t)
+{
+  struct schedgroup *g = t->group;
+  bool parked = false;
+
+  if (t->edf || !g->throttled)
+    return false;
+
+  spin_lock (&g->lock);
+  if (g->throttled)
+    {
+      ready_queue_remove (rq, t);
+      t->status = THREAD_BLOCKED;
+      if (thread_cfs)
+        t->vruntime -= group_rq (rq, g)->min_vruntime;
+      list_push_back (&g->parked, &t->elem);
+      parked = true;
+    }
+  spin_unlock (&g->lock);
+  return parked;
 }
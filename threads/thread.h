@@ -2,10 +2,18 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include "threads/synch.h"
 #include "filesys/file.h"
+#include "devices/timeout.h"
+
+struct cpu;
+struct schedgroup;
+struct spinlock;
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -26,6 +34,10 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* File Descriptor */
 #define FD_MIN 2
 #define FD_MAX 128
@@ -80,12 +92,10 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore is instead in the semaphore's
+   heap of waiters (synch.c) through `wait_elem', so that it can
+   still be found there and moved when its priority changes. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -98,11 +108,39 @@ struct thread
     // Priority Inversion Problem
     int init_priority;                  /* Initial priority */
     struct lock *wait_on_lock;          /* Lock which this thread waiting */
-    struct list donations;              /* for Multiple donations */
-    struct list_elem donation_elem;     /* for Multiple donations */
+    struct heap held_locks;             /* Locks held, by donated priority. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Owned by thread.c. */
     struct list_elem elem;              /* List element. */
+    struct cpu *cpu;                    /* CPU running us, or whose run queue we are on. */
+    volatile bool on_cpu;               /* Still using a CPU's registers or stack? */
+
+    /* Owned by thread.c, for the completely fair scheduler. */
+    int64_t vruntime;                   /* Virtual runtime; see thread.c. */
+    struct rb_elem cfs_elem;            /* Element in group's tree. */
+    struct schedgroup *group;           /* Scheduling group. */
+
+    /* Owned by thread.c, for scheduling statistics. */
+    struct schedstat stats;             /* See lib/schedstat.h. */
+    int64_t ready_since;                /* clock_ns() when last made ready. */
+    bool woken;                         /* Made ready by thread_unblock()? */
+
+    /* Owned by thread.c, for the EDF real-time class. */
+    bool edf;                           /* Created by thread_create_edf()? */
+    bool edf_throttled;                 /* Out of budget for this period? */
+    int edf_runtime;                    /* Ticks of CPU time per period. */
+    int edf_period;                     /* Length of a period, in ticks. */
+    int edf_budget;                     /* Ticks left in this period. */
+    int64_t edf_deadline;               /* Tick at which this period ends. */
+    struct heap_elem edf_elem;          /* Element in run queue's heap. */
+    struct timeout edf_timer;           /* Ends throttling at deadline. */
+
+    /* Owned by synch.c. */
+    struct heap_elem wait_elem;         /* Element in semaphore's waiters. */
+    struct semaphore *wait_sema;        /* Semaphore we are blocked on. */
+    struct condition *wait_cond;        /* Condition we are waiting on. */
+    struct heap_elem *wait_cond_elem;   /* Our element in its waiters. */
+    volatile int wait_pins;             /* # of CPUs moving us in waiters. */
 
     // MLFQ
     int nice;
@@ -111,9 +149,8 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct cpu *pd_cpu;                 /* CPU that last loaded pagedir. */
 #endif
-    /* wakeup tick */
-    int64_t wakeup_tick;
 
     // Implement process hierarchy
     struct thread *parent;              /* Parent process descriptor. */
@@ -142,16 +179,35 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* If true, print each thread's scheduling statistics and
+   histograms of run queue waits at shutdown.
+   Controlled by kernel command-line option "-schedstat". */
+extern bool thread_schedstat;
+
+/* Bound on the total CPU utilization of EDF threads, in percent
+   of one CPU.  thread_create_edf() refuses threads beyond it.
+   Controlled by kernel command-line option "-edf-bound=PCT". */
+extern int thread_edf_bound;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
+void thread_idle_tick (void);
 void thread_print_stats (void);
+bool thread_get_schedstat (tid_t, struct schedstat *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_edf (const char *name, int runtime, int period,
+                         thread_func *, void *);
 
 void thread_block (void);
+void thread_block_unlock (struct spinlock *);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
@@ -160,6 +216,15 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_release_child (struct thread *);
+
+/* For use by threads/cpu.c. */
+struct thread *thread_prepare_ap (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
+
+/* For use by threads/schedgroup.c. */
+void thread_init_group (struct schedgroup *);
+struct schedgroup *thread_set_group (struct schedgroup *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -173,22 +238,13 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-// Process hierarchy
-
-void thread_sleep (int64_t ticks);  /* sleep running thread */
-void thread_awake (int64_t ticks);  /* wakeup thread in thread sleep_list */
-void update_next_tick_to_awake (int64_t ticks); /* update minimal wakeup_tick */
-int64_t get_next_tick_to_awake (void);  /* return next_tick_to_awake value */
-
 // compare current running thread and highist priority thread
 // and then run schedule higher one
 void test_max_priority (void);
-// compare two threads, a and b, then return true if a > b, or return false if a <= b.
-bool cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 
 // Priority Inversion Problem
+extern struct spinlock donation_lock;       /* Protects donation state. */
 void donate_priority(void);                 /* Priority donation */
-void remove_with_lock(struct lock *lock);   /* Remove thread entry from donation list*/
 void refresh_priority(void);                /* Recalaulate priority */
 
 // MLFQ
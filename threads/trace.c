@@ -0,0 +1,183 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/clock.h"
+#include "threads/cpu.h"
+#include "threads/flags.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Kernel event trace.
+
+   Each CPU records events in its own ring buffer of the last
+   TRACE_CNT events, so recording needs no lock: only the CPU
+   itself writes its ring, with interrupts off, so that an
+   interrupt handler that records an event cannot interleave
+   with the thread it interrupted.  An event is 16 bytes and
+   costs a few tens of cycles, mostly for reading the time-stamp
+   counter, so tracing is always on.
+
+   With "-trace", the rings are printed at shutdown, one event
+   per line, as "trace: CPU TSC TYPE TID ARG" with the numbers
+   in hexadecimal.  The lines are preceded by the TSC frequency
+   and followed by the names of the threads still alive.
+   utils/trace2json turns them into a timeline that the Chrome
+   trace viewer (chrome://tracing) or Perfetto can display. */
+
+bool trace_enabled;
+
+/* Number of pages in each CPU's ring. */
+#define TRACE_PAGES 4
+
+/* Number of events in each CPU's ring. */
+#define TRACE_CNT (TRACE_PAGES * PGSIZE / sizeof (struct trace_event))
+
+/* A trace event. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint8_t type;               /* A TRACE_* value. */
+    uint8_t cpu;                /* CPU's index in cpus[]. */
+    uint16_t tid;               /* Running thread's tid. */
+    uint32_t arg;               /* Depends on type. */
+  };
+
+/* A thread's name, copied for trace_print_stats(). */
+struct trace_name
+  {
+    tid_t tid;                  /* Thread identifier. */
+    char name[16];              /* Thread name. */
+  };
+
+/* Buffer of thread names, for trace_print_stats(). */
+struct name_buf
+  {
+    struct trace_name *names;   /* Array of MAX names. */
+    size_t cnt, max;            /* Number used, capacity. */
+  };
+
+static void copy_thread_name (struct thread *, void *buf);
+
+/* Allocates the bootstrap processor's ring. */
+void
+trace_init (void)
+{
+  trace_init_ap (&cpus[0]);
+}
+
+/* Allocates the ring of CPU C.  If memory is short, C's events
+   are not recorded. */
+void
+trace_init_ap (struct cpu *c)
+{
+  c->trace_buf = palloc_get_multiple (PAL_ZERO, TRACE_PAGES);
+  c->trace_head = 0;
+}
+
+/* Records an event of the given TYPE with argument ARG on the
+   current CPU.  May be called in any context, with interrupts
+   on or off. */
+void
+trace_record (enum trace_type type, uint32_t arg)
+{
+  struct trace_event *e;
+  struct cpu *c;
+  uint32_t flags;
+
+  /* Inline equivalent of intr_disable(). */
+  asm volatile ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+
+  c = cpu_current ();
+  if (c->trace_buf != NULL)
+    {
+      e = &c->trace_buf[c->trace_head++ % TRACE_CNT];
+      e->tsc = rdtsc ();
+      e->type = type;
+      e->cpu = c->id;
+      e->tid = c->curr != NULL ? c->curr->tid : 0;
+      e->arg = arg;
+    }
+
+  if (flags & FLAG_IF)
+    asm volatile ("sti" : : : "memory");
+}
+
+/* Prints every CPU's ring, oldest events first, if "-trace" was
+   given.  Each ring, and then the thread names, are copied with
+   interrupts off and printed afterward, because printing may
+   sleep and thread_foreach() holds a spin lock. */
+void
+trace_print_stats (void)
+{
+  struct trace_event *events;
+  struct name_buf buf;
+  enum intr_level old_level;
+  size_t j;
+  int i;
+
+  if (!trace_enabled)
+    return;
+
+  events = palloc_get_multiple (0, TRACE_PAGES);
+  buf.names = palloc_get_page (0);
+  if (events == NULL || buf.names == NULL)
+    {
+      printf ("trace: out of memory\n");
+      palloc_free_multiple (events, TRACE_PAGES);
+      palloc_free_page (buf.names);
+      return;
+    }
+  buf.max = PGSIZE / sizeof *buf.names;
+  buf.cnt = 0;
+
+  printf ("trace: tsc-hz %"PRIu64"\n", clock_tsc_hz ());
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      size_t cnt = 0;
+      uint32_t n;
+
+      if (c->trace_buf == NULL)
+        continue;
+      old_level = intr_disable ();
+      n = c->trace_head > TRACE_CNT ? c->trace_head - TRACE_CNT : 0;
+      for (; n != c->trace_head; n++)
+        events[cnt++] = c->trace_buf[n % TRACE_CNT];
+      intr_set_level (old_level);
+
+      for (j = 0; j < cnt; j++)
+        {
+          struct trace_event *e = &events[j];
+          printf ("trace: %x %"PRIx64" %x %x %"PRIx32"\n",
+                  e->cpu, e->tsc, e->type, e->tid, e->arg);
+        }
+    }
+
+  old_level = intr_disable ();
+  thread_foreach (copy_thread_name, &buf);
+  intr_set_level (old_level);
+  for (j = 0; j < buf.cnt; j++)
+    printf ("trace: thread %x %s\n", buf.names[j].tid, buf.names[j].name);
+
+  palloc_free_page (buf.names);
+  palloc_free_multiple (events, TRACE_PAGES);
+}
+
+/* Copies the identifier and name of thread T into the name_buf
+   BUF, for trace_print_stats(). */
+static void
+copy_thread_name (struct thread *t, void *buf_)
+{
+  struct name_buf *buf = buf_;
+
+  if (buf->cnt < buf->max)
+    {
+      struct trace_name *n = &buf->names[buf->cnt++];
+      n->tid = t->tid;
+      strlcpy (n->name, t->name, sizeof n->name);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct cpu;
+
+/* Kinds of trace events, and the meaning of each one's
+   argument.  Each event also records the CPU, the time-stamp
+   counter, and the thread running on the CPU. */
+enum trace_type
+  {
+    TRACE_SWITCH = 1,           /* Switching to thread with tid ARG. */
+    TRACE_BLOCK,                /* Running thread blocked. */
+    TRACE_UNBLOCK,              /* Thread with tid ARG unblocked. */
+    TRACE_SYSCALL_ENTER,        /* System call number ARG. */
+    TRACE_SYSCALL_EXIT,         /* System call returning ARG. */
+    TRACE_PAGE_FAULT,           /* Page fault at address ARG. */
+    TRACE_BLOCK_SUBMIT,         /* Block I/O on sector ARG started. */
+    TRACE_BLOCK_COMPLETE,       /* Block I/O on sector ARG done. */
+    TRACE_LOCK_CONTEND          /* Must wait for lock at address ARG. */
+  };
+
+/* Set in the argument of block I/O events for writes. */
+#define TRACE_BLOCK_WRITE 0x80000000
+
+/* If false (default), the trace is recorded but not printed.
+   If true, set by kernel command-line option "-trace", it is
+   printed at shutdown. */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_init_ap (struct cpu *);
+void trace_record (enum trace_type, uint32_t arg);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
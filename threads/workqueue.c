@@ -0,0 +1,148 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads.  More than one, so that work that
+   sleeps for a long time, say on disk I/O, does not hold up
+   everything queued behind it. */
+#define WORKER_CNT 2
+
+/* Queued work items, in the order queued. */
+static struct list work_list;
+
+/* Protects work_list, including the `pending' members of the
+   work items in it. */
+static struct spinlock work_lock;
+
+/* Up'd once for every work item queued. */
+static struct semaphore work_sema;
+
+static thread_func worker;
+
+/* Starts the worker threads.  Must be called after
+   thread_start() and before any work is queued. */
+void
+workqueue_init (void)
+{
+  int i;
+
+  list_init (&work_list);
+  spinlock_init (&work_lock);
+  sema_init (&work_sema, 0);
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "kworker %d", i);
+      thread_create (name, PRI_DEFAULT, worker, NULL);
+    }
+}
+
+/* Initializes W to call FUNC with AUX when it runs.  W is not
+   pending until work_queue() is called. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Queues W to be run by a worker thread.  Returns true if W was
+   queued, false if it was already pending.  May be called in any
+   context, including from an interrupt handler. */
+bool
+work_queue (struct work *w)
+{
+  enum intr_level old_level;
+  bool queued;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&work_lock);
+  queued = !w->pending;
+  if (queued)
+    {
+      w->pending = true;
+      list_push_back (&work_list, &w->elem);
+    }
+  spin_unlock (&work_lock);
+  if (queued)
+    sema_up (&work_sema);
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Takes W off the queue.  Returns true if W was pending, false
+   if it has already started running or was never queued.  In
+   the latter case, W's function may still be running. */
+bool
+work_cancel (struct work *w)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  spin_lock (&work_lock);
+  was_pending = w->pending;
+  if (was_pending)
+    {
+      list_remove (&w->elem);
+      w->pending = false;
+    }
+  spin_unlock (&work_lock);
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Returns true if W has been queued and has neither started
+   running nor been cancelled. */
+bool
+work_pending (const struct work *w)
+{
+  return w->pending;
+}
+
+/* Worker thread.  Runs queued work items, one at a time, for
+   ever.  work_sema may count items that were later cancelled, in
+   which case there is nothing to do. */
+static void
+worker (void *aux_ UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w = NULL;
+      work_func *func = NULL;
+      void *aux = NULL;
+
+      sema_down (&work_sema);
+
+      old_level = intr_disable ();
+      spin_lock (&work_lock);
+      if (!list_empty (&work_list))
+        {
+          w = list_entry (list_pop_front (&work_list), struct work, elem);
+          w->pending = false;
+          func = w->func;
+          aux = w->aux;
+        }
+      spin_unlock (&work_lock);
+      intr_set_level (old_level);
+
+      if (w != NULL)
+        func (aux);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Work items run by kernel worker threads.
+
+   Work queued with work_queue() is run, in the order queued, by
+   one of a pool of kernel threads.  Unlike a softirq handler or
+   a timeout function, FUNC runs in an ordinary thread, so it may
+   sleep, acquire locks, and do I/O.  Work may be queued from any
+   context, including interrupt handlers, so this is the way for
+   them to get such things done.
+
+   A work item is either pending, on the queue, or not.  Queueing
+   a pending item again has no effect.  An item stops being
+   pending just before FUNC is called, so FUNC may queue its own
+   item again, and may free it. */
+
+typedef void work_func (void *aux);
+
+struct work
+  {
+    struct list_elem elem;      /* Element in the work queue. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Queued and not yet started? */
+  };
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+bool work_cancel (struct work *);
+bool work_pending (const struct work *);
+
+void workqueue_init (void);
+
+#endif /* threads/workqueue.h */
@@ -30,13 +30,13 @@ static uint64_t make_data_desc (int dpl);
 static uint64_t make_tss_desc (void *laddr);
 static uint64_t make_gdtr_operand (uint16_t limit, void *base);
 
+static void load_gdt (int cpu_id);
+
 /* Sets up a proper GDT.  The bootstrap loader's GDT didn't
    include user-mode selectors or a TSS, but we need both now. */
 void
 gdt_init (void)
 {
-  uint64_t gdtr_operand;
-
   /* Initialize GDT. */
   gdt[SEL_NULL / sizeof *gdt] = 0;
   gdt[SEL_KCSEG / sizeof *gdt] = make_code_desc (0);
@@ -44,15 +44,35 @@ gdt_init (void)
   gdt[SEL_UCSEG / sizeof *gdt] = make_code_desc (3);
   gdt[SEL_UDSEG / sizeof *gdt] = make_data_desc (3);
   gdt[SEL_TSS / sizeof *gdt] = make_tss_desc (tss_get ());
+  load_gdt (0);
+}
+
+/* Adds the TSS of application processor C, which must be the
+   running CPU, to the GDT, and loads the GDT on it. */
+void
+gdt_init_ap (struct cpu *c)
+{
+  ASSERT (c->id > 0 && c->id < CPU_MAX);
+
+  gdt[SEL_TSS_CPU (c->id) / sizeof *gdt] = make_tss_desc (c->tss);
+  load_gdt (c->id);
+}
+
+/* Loads the GDT on the running CPU, which is number CPU_ID, and
+   its TSS. */
+static void
+load_gdt (int cpu_id)
+{
+  uint64_t gdtr_operand;
 
   /* Load GDTR, TR.  See [IA32-v3a] 2.4.1 "Global Descriptor
      Table Register (GDTR)", 2.4.4 "Task Register (TR)", and
      6.2.4 "Task Register".  */
   gdtr_operand = make_gdtr_operand (sizeof gdt - 1, gdt);
   asm volatile ("lgdt %0" : : "m" (gdtr_operand));
-  asm volatile ("ltr %w0" : : "q" (SEL_TSS));
+  asm volatile ("ltr %w0" : : "q" (SEL_TSS_CPU (cpu_id)));
 }
-
+
 /* System segment or code/data segment? */
 enum seg_class
   {
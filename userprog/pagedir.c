@@ -2,12 +2,16 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/thread.h"
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void release_pagedir (uint32_t *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -23,7 +27,8 @@ pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  No thread may be using PD, but CPUs running
+   kernel threads that borrowed it are made to switch away. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -33,6 +38,7 @@ pagedir_destroy (uint32_t *pd)
     return;
 
   ASSERT (pd != init_page_dir);
+  release_pagedir (pd);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P) 
       {
@@ -219,6 +225,8 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
 void
 pagedir_activate (uint32_t *pd) 
 {
+  enum intr_level old_level;
+
   if (pd == NULL)
     pd = init_page_dir;
 
@@ -227,7 +235,24 @@ pagedir_activate (uint32_t *pd)
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
      Address of the Page Directory". */
+  old_level = intr_disable ();
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  cpu_current ()->active_pd = pd;
+  intr_set_level (old_level);
+}
+
+/* If the running thread is a kernel thread that borrowed the
+   page directory of a process (see process_activate()), switches
+   to the kernel-only page directory.  Called from the reschedule
+   IPI handler, on behalf of release_pagedir(). */
+void
+pagedir_unlazy (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_current ()->pagedir == NULL
+      && cpu_current ()->active_pd != init_page_dir)
+    pagedir_activate (NULL);
 }
 
 /* Returns the currently active page directory. */
@@ -243,6 +268,41 @@ active_pd (void)
   return ptov (pd);
 }
 
+/* Waits until no CPU has page directory PD loaded, asking any
+   CPU that does to switch away from it.  Only kernel threads can
+   still be running on PD, because its process is exiting, and
+   they never touch user memory. */
+static void
+release_pagedir (uint32_t *pd)
+{
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      bool kicked = false;
+
+      for (;;)
+        {
+          enum intr_level old_level = intr_disable ();
+          bool held = c->active_pd == pd;
+
+          /* The running thread may itself have moved to C and
+             borrowed PD there. */
+          if (held && c == cpu_current ())
+            pagedir_activate (NULL);
+          else if (held && !kicked)
+            {
+              cpu_kick (c);
+              kicked = true;
+            }
+          intr_set_level (old_level);
+          if (!held)
+            break;
+        }
+    }
+}
+
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
    table.  When this happens, we have to "invalidate" the TLB by
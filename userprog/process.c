@@ -13,6 +13,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -247,20 +248,60 @@ process_exit (void)
 
 /* Sets up the CPU for running user code in the current
    thread.
-   This function is called on every context switch. */
+   This function is called on every context switch.
+
+   Loading a page directory flushes the TLB, so it is skipped
+   where it would not change anything.  A kernel thread never
+   touches user memory, so it keeps whatever page directory is
+   loaded, borrowing the address space of the last process that
+   ran on this CPU.  A process's own page directory is not
+   reloaded if it is still loaded and the process has not run on
+   another CPU since it was, because the process may have changed
+   its page tables there without flushing this CPU's TLB. */
 void
 process_activate (void)
 {
   struct thread *t = thread_current ();
+  enum intr_level old_level;
+  struct cpu *c;
+
+  old_level = intr_disable ();
+  c = cpu_current ();
 
   /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  if (t->pagedir == NULL
+      || (t->pagedir == c->active_pd && t->pd_cpu == c))
+    c->pd_skips++;
+  else
+    {
+      pagedir_activate (t->pagedir);
+      t->pd_cpu = c;
+      t->stats.pd_load_cnt++;
+      c->pd_loads++;
+    }
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
   tss_update ();
+  intr_set_level (old_level);
 }
-
+
+/* Prints page directory statistics. */
+void
+process_print_stats (void)
+{
+  long long loads = 0, skips = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      loads += cpus[i].pd_loads;
+      skips += cpus[i].pd_skips;
+    }
+  printf ("Process: %lld page directory loads, %lld avoided\n",
+          loads, skips);
+}
+
 /* We load ELF binaries.  The following definitions are taken
    from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -351,13 +392,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
   process_activate ();
 
   // Acquire lock
-  lock_acquire (&filesys_lock);
+  rwlock_acquire_write (&filesys_lock);
 
   /* Open executable file. */
   file = filesys_open (file_name);
   if (file == NULL)
     {
-      lock_release (&filesys_lock);
+      rwlock_release_write (&filesys_lock);
       printf ("load: %s: open failed\n", file_name);
       goto done;
     }
@@ -365,7 +406,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   // Denying write to Executable & release lock
   thread_current ()->run_file = file;
   file_deny_write (thread_current ()->run_file);
-  lock_release (&filesys_lock);
+  rwlock_release_write (&filesys_lock);
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -620,8 +661,7 @@ get_child_process (int pid)
 void
 remove_child_process (struct thread *cp)
 {
-  list_remove (&cp->child);
-  palloc_free_page (cp);
+  thread_release_child (cp);
 }
 
 int
@@ -7,6 +7,7 @@ tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_print_stats (void);
 
 struct thread *get_child_process (int pid);
 void remove_child_process (struct thread *cp);
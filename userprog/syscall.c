@@ -2,7 +2,9 @@
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/schedgroup.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include <devices/shutdown.h>
 #include "devices/input.h"
 #include "filesys/filesys.h"
@@ -16,7 +18,7 @@ void
 syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init(&filesys_lock);
+  rwlock_init (&filesys_lock, "filesys");
 }
 
 static void
@@ -30,6 +32,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 
   // Check if stack pointer is in the user memory area
   chec_address (f->esp);
+  trace_record (TRACE_SYSCALL_ENTER, *(int *)(f->esp));
 
   // Save user stack arguments in kernel
   switch (*(int *)(f->esp))
@@ -137,9 +140,49 @@ syscall_handler (struct intr_frame *f UNUSED)
       close (fd);
       break;
 
+    case SYS_SCHEDSTAT:
+      get_argument (f->esp, (int *)arg, 2);
+      chec_address((void *)arg[0]);
+      chec_address((void *)arg[1]);
+      pid = *(int *)arg[0];
+      buffer = *(void **)arg[1];
+      chec_address (buffer);
+      chec_address (buffer + sizeof (struct schedstat) - 1);
+      f->eax = schedstat (pid, buffer);
+      break;
+
+    case SYS_SCHEDGROUP_CREATE:
+      f->eax = schedgroup_create ();
+      break;
+
+    case SYS_SCHEDGROUP_JOIN:
+      get_argument (f->esp, (int *)arg, 1);
+      chec_address((void *)arg[0]);
+      f->eax = ((*(int *)arg[0] == SCHEDGROUP_ROOT
+                 || schedgroup_owned (*(int *)arg[0]))
+                && schedgroup_join (*(int *)arg[0]));
+      break;
+
+    case SYS_SCHEDGROUP_SET:
+      {
+        struct schedgroup_params params;
+
+        get_argument (f->esp, (int *)arg, 2);
+        chec_address((void *)arg[0]);
+        chec_address((void *)arg[1]);
+        buffer = *(void **)arg[1];
+        chec_address (buffer);
+        chec_address (buffer + sizeof params - 1);
+        params = *(struct schedgroup_params *) buffer;
+        f->eax = (schedgroup_owned (*(int *)arg[0])
+                  && schedgroup_set (*(int *)arg[0], &params));
+      }
+      break;
+
     default:
       thread_exit ();
   }
+  trace_record (TRACE_SYSCALL_EXIT, f->eax);
   // delete when implementation finished
   //thread_exit ();
 }
@@ -188,6 +231,8 @@ exec (const char *cmd_line)
 
   pid = process_execute(cmd_line);
   child_process = get_child_process(pid);
+  if (child_process == NULL)
+    return -1;
 
   sema_down(&child_process->load);
 
@@ -262,8 +307,6 @@ read (int fd, void *buffer, unsigned size)
   unsigned i = 0;
   int read_size = 0;
 
-  lock_acquire(&filesys_lock);
-
   if (fd == STDIN_FILENO)
   {
     for(i = 0; i < size; i++)
@@ -280,11 +323,14 @@ read (int fd, void *buffer, unsigned size)
     if (f == NULL)
       read_size = -1;
     else
+    {
+      // Readers of the file system may run in parallel
+      rwlock_acquire_read (&filesys_lock);
       read_size = file_read(f, buffer, size);
+      rwlock_release_read (&filesys_lock);
+    }
   }
 
-  lock_release(&filesys_lock);
-
   return read_size;
 }
 
@@ -294,8 +340,7 @@ write (int fd, void *buffer, unsigned size)
   struct file *f = NULL;
   int read_size = 0;
 
-  lock_acquire (&filesys_lock);
-
+  // The console has its own lock
   if (fd == STDOUT_FILENO)
   {
     putbuf ((char *)buffer, size);
@@ -308,11 +353,13 @@ write (int fd, void *buffer, unsigned size)
     if (f == NULL)
       read_size = -1;
     else
+    {
+      rwlock_acquire_write (&filesys_lock);
       read_size = file_write (f, buffer, size);
+      rwlock_release_write (&filesys_lock);
+    }
   }
 
-  lock_release (&filesys_lock);
-
   return read_size;
 }
 
@@ -340,3 +387,18 @@ close (int fd)
   process_close_file(fd);
   t->fd_size--;
 }
+
+bool
+schedstat (pid_t pid, struct schedstat *stats)
+{
+  struct schedstat copy;
+
+  // Pid 0 is the calling process.  Copy the statistics out
+  // before touching user memory, which may fault.
+  if (pid == 0)
+    pid = thread_tid ();
+  if (!thread_get_schedstat (pid, &copy))
+    return false;
+  *stats = copy;
+  return true;
+}
@@ -1,11 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <schedstat.h>
 #include "threads/synch.h"
 
 typedef int pid_t;
 
-struct lock filesys_lock;
+struct rwlock filesys_lock;
 
 void syscall_init (void);
 // project_2
@@ -24,5 +25,7 @@ int write (int fd, void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+// Scheduling statistics
+bool schedstat (pid_t, struct schedstat *);
 
 #endif /* userprog/syscall.h */
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -72,35 +73,53 @@ struct tss
     uint16_t trace, bitmap;
   };
 
-/* Kernel TSS. */
-static struct tss *tss;
+static struct tss *alloc_tss (void);
 
-/* Initializes the kernel TSS. */
+/* Initializes the bootstrap processor's TSS. */
 void
 tss_init (void) 
 {
-  /* Our TSS is never used in a call gate or task gate, so only a
-     few fields of it are ever referenced, and those are the only
-     ones we initialize. */
-  tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
-  tss->ss0 = SEL_KDSEG;
-  tss->bitmap = 0xdfff;
+  cpus[0].tss = alloc_tss ();
   tss_update ();
 }
 
-/* Returns the kernel TSS. */
+/* Initializes the TSS of application processor C, which is not
+   running yet. */
+void
+tss_init_ap (struct cpu *c)
+{
+  c->tss = alloc_tss ();
+}
+
+/* Returns the running CPU's TSS. */
 struct tss *
 tss_get (void) 
 {
+  struct tss *tss = cpu_current ()->tss;
+
   ASSERT (tss != NULL);
   return tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS to point
+   to the end of the thread stack.  Interrupts must be off. */
 void
 tss_update (void) 
 {
-  ASSERT (tss != NULL);
-  tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  tss_get ()->esp0 = (uint8_t *) thread_current () + PGSIZE;
+}
+
+/* Allocates and initializes a kernel TSS. */
+static struct tss *
+alloc_tss (void)
+{
+  struct tss *tss;
+
+  /* Our TSS is never used in a call gate or task gate, so only a
+     few fields of it are ever referenced, and those are the only
+     ones we initialize. */
+  tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  tss->ss0 = SEL_KDSEG;
+  tss->bitmap = 0xdfff;
+  return tss;
 }
@@ -4,7 +4,9 @@
 #include <stdint.h>
 
 struct tss;
+struct cpu;
 void tss_init (void);
+void tss_init_ap (struct cpu *);
 struct tss *tss_get (void);
 void tss_update (void);
 